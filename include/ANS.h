@@ -0,0 +1,119 @@
+#ifndef ANS_H
+#define ANS_H
+
+#include "Image.h"
+#include "BitStream.h"
+#include "Histogram.h"
+
+#include <vector>
+#include <fstream>
+#include <cstdint>
+
+/**
+ * Table based asymmetric numeral system (tANS) - every symbol moves state of coder through table,
+ * so symbols can take fractional number of bits (close to entropy even for the most common ones)
+ * Remarks: frequencies are normalized to 2^tableLog, symbols are coded in reversed order
+ *          and decoded in original one (any stream of symbols of set alphabet can be coded)
+ */
+class ANS
+{
+public:
+
+	// Limits of number of bits of state (size of tables is 2^tableLog)
+	static constexpr unsigned int min_table_log = 11u;
+	static constexpr unsigned int max_table_log = 15u;
+
+private:
+
+	// One state of decoder
+	struct Entry
+	{
+		uint16_t base; // the next state without read bits
+		uint16_t symbol;
+		uint8_t bits; // number of read bits
+	};
+
+	// Number of symbols
+	size_t alphabet;
+
+	// Number of bits of state
+	unsigned int tableLog;
+
+	// Normalized frequencies (their sum is 2^tableLog, 0 for not appeared symbols)
+	std::vector<uint32_t> norms;
+
+	// Encoding: the next states of every symbol (starting at start[symbol]),
+	// the most bits written by symbol and state from which it writes them
+	std::vector<uint32_t> states, start, threshold;
+	std::vector<uint8_t> maxBits;
+
+	// Decoding table and current state
+	std::vector<Entry> decoding;
+	uint32_t state;
+
+	/**
+	 * @param number of all symbols' frequencies
+	 * @param number of appeared symbols
+	 * @return number of bits of state precise enough for them
+	 */
+	static unsigned int chooseTableLog(uint64_t total, size_t symbols);
+
+	// Scales frequencies to 2^tableLog, every appeared symbol keeps at least 1
+	void normalize(const std::vector<uint32_t> &freqs, uint64_t total);
+
+	// @return symbol of every state (states of every symbol are spread over whole table)
+	std::vector<uint16_t> spread() const;
+
+	// Create tables from normalized frequencies
+	void buildEncoding();
+	void buildDecoding();
+
+public:
+
+	// @param number of symbols (the first one is 0)
+	explicit ANS(size_t alphabet = Histogram::size);
+
+	/**
+	 * Creates encoding table
+	 * @param frequencies of all symbols (at least one not 0)
+	 */
+	void build(const std::vector<uint32_t> &freqs);
+
+	/**
+	 * Save/load number of bits of state and normalized frequencies
+	 * @throws RuntimeError when loaded ones are not vaild
+	 */
+	void saveTable(BitWriter &writer) const;
+	void readTable(BitReader &reader);
+
+	/**
+	 * Codes symbols with built table (reversed, so they are decoded in order)
+	 * @param symbols having not 0 frequency
+	 * @param writer of bits
+	 */
+	void encode(const std::vector<uint16_t> &symbols, BitWriter &writer) const;
+
+	// Reads the first state of decoder (right after saved table)
+	void begin(BitReader &reader);
+
+	// @return the next symbol
+	uint16_t next(BitReader &reader);
+
+	// Public interface (pixels are symbols)
+	void encode(std::ofstream &, const Image &);
+	void decode(std::ifstream &, Image &);
+};
+
+//------------------------------INLINE DEFINITIONS------------------------------
+// Remarks: it is called for every symbol, so it is kept in header
+
+inline uint16_t ANS::next(BitReader &reader)
+{
+	reader.refill();
+	const Entry &entry = decoding[state];
+	state = entry.base + (entry.bits ? reader.peek(entry.bits) : 0u);
+	reader.consume(entry.bits);
+	return entry.symbol;
+}
+
+#endif // !ANS_H
@@ -0,0 +1,85 @@
+#ifndef ADAPTIVE_HUFFMAN_H
+#define ADAPTIVE_HUFFMAN_H
+
+#include "Image.h"
+#include "Huffman.h"
+#include "Histogram.h"
+
+#include <vector>
+#include <array>
+#include <fstream>
+#include <cstdint>
+
+/**
+ * One pass Huffman coding - codes are rebuilt periodically from frequencies of already coded
+ * pixels and the decoder rebuilds the same ones, so no frequencies are saved and every row
+ * is coded right when it is reached
+ * Remarks: color not coded before is saved as escape code followed by its 12 bits
+ */
+class AdaptiveHuffman
+{
+public:
+
+	// Number of pixels coded before the first rebuild (the interval doubles after every rebuild)
+	static constexpr size_t first_interval = 64u;
+
+	// The longest interval between rebuilds
+	static constexpr size_t max_interval = 1u << 14;
+
+	// Frequencies are halved when their sum exceeds this (recent pixels have bigger weight)
+	static constexpr uint32_t max_total = 1u << 16;
+
+private:
+
+	// Symbol of escape code (after all colors)
+	static constexpr uint32_t escape = Histogram::size;
+
+	// Number of symbols (colors and escape)
+	static constexpr size_t symbols = Histogram::size + 1;
+
+	// Frequencies of coded colors and escape (0 for colors not coded yet)
+	std::array<uint32_t, symbols> freqs;
+	uint32_t total;
+
+	// Number of pixels coded with current codes and when they are rebuilt
+	size_t coded, interval;
+
+	// Code (in the lowest bits) and its length for every symbol (0 length when it has none)
+	std::vector<std::pair<uint32_t, uint8_t>> codes;
+
+	// Symbol and length of code for every possible following bits (0 length when there is none)
+	std::vector<std::pair<uint16_t, uint8_t>> table;
+
+	// Limit of code's length set by user
+	unsigned int maxLength;
+
+	// Limit of code's length used by current codes (and number of bits looked up in table at once)
+	unsigned int lengthLimit;
+
+	// Forgets all frequencies, so only escape code exists
+	void reset();
+
+	/**
+	 * Counts coded pixel and rebuilds codes when interval is reached
+	 * @param color of pixel
+	 * @param true if it was coded after escape code
+	 */
+	void update(uint32_t color, bool escaped);
+
+	// Creates canonical codes (ordered by length and symbol) from current frequencies
+	void rebuild();
+
+public:
+
+	/**
+	 * @param limit of code's length in bits (at most Huffman::max_length_limit, saved in header) | 0 for default one
+	 * Remarks: limit is raised when it is too short to give every color its code
+	 */
+	explicit AdaptiveHuffman(unsigned int maxLength = Huffman::default_max_length);
+
+	// Public interface
+	void encode(std::ofstream &, const Image &);
+	void decode(std::ifstream &, Image &);
+};
+
+#endif // !ADAPTIVE_HUFFMAN_H
@@ -0,0 +1,167 @@
+#ifndef BIT_STREAM_H
+#define BIT_STREAM_H
+
+#include "ChunkReader.h"
+
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include <cstddef>
+#include <cstring> // memcpy
+
+// Bits written to memory (most significant first) through 64 bit accumulator
+class BitWriter
+{
+private:
+	std::vector<uint8_t> buffer;
+	uint64_t bits; // the last put bit is the lowest one
+	unsigned int count; // number of bits not moved to buffer (less than 32)
+
+public:
+	BitWriter();
+
+	/**
+	 * Puts the lowest bits of code (most significant first)
+	 * @param code
+	 * @param number of bits (at most 32)
+	 */
+	void put(uint32_t code, unsigned int length);
+
+	// Puts bits one by one (e.g. codes longer than 32 bits)
+	void put(const std::vector<bool> &code);
+
+	/**
+	 * Fills the last byte with 0
+	 * @return all written bytes
+	 */
+	const std::vector<uint8_t>& flush();
+
+	// Flushes bits and moves them to file
+	void write(std::ofstream &file);
+
+	// Moves only whole bytes to file (bits of not finished byte stay, so more can be put)
+	void drain(std::ofstream &file);
+};
+
+// Bits read from memory or file chunks (most significant first) through 64 bit accumulator
+// Remarks: bits following the end are 0, vaild() tells whether any of them was consumed
+class BitReader
+{
+private:
+	ChunkReader *source; // next chunks of data (nullptr when all are in memory)
+	const uint8_t *next, *end;
+	uint64_t bits; // the next bit is the highest one
+	unsigned int count; // number of available bits
+	size_t padding; // number of bits added after the end
+
+	// Refills byte by byte near the end of data (or chunk)
+	void refillTail();
+
+public:
+	BitReader(const uint8_t *begin, const uint8_t *end);
+
+	// Reads chunks of file (source must exist while bits are read)
+	explicit BitReader(ChunkReader &source);
+
+	// Makes at least 56 bits available
+	void refill();
+
+	/**
+	 * @param number of bits (1 - 32, at most available ones)
+	 * @return next bits without consuming them
+	 */
+	uint32_t peek(unsigned int length) const;
+
+	// @param number of bits to consume (at most available ones)
+	void consume(unsigned int length);
+
+	// @return the next bit (refills itself)
+	bool get();
+
+	// @return true if only bits of data were consumed
+	bool vaild() const;
+};
+
+//------------------------------INLINE DEFINITIONS------------------------------
+// Remarks: they are called for every code, so they are kept in header
+
+inline BitWriter::BitWriter()
+	: bits(0), count(0)
+{}
+
+inline void BitWriter::put(uint32_t code, unsigned int length)
+{
+	bits = bits << length | (code & ((uint64_t(1) << length) - 1));
+	count += length;
+
+	// Whole 32 bit word is moved to buffer at once
+	if (count >= 32)
+	{
+		count -= 32;
+		const uint32_t word = static_cast<uint32_t>(bits >> count);
+		const uint8_t out[4] = {
+			static_cast<uint8_t>(word >> 24),
+			static_cast<uint8_t>(word >> 16),
+			static_cast<uint8_t>(word >> 8),
+			static_cast<uint8_t>(word) };
+		buffer.insert(buffer.end(), out, out + 4);
+	}
+}
+
+inline BitReader::BitReader(const uint8_t *begin, const uint8_t *end)
+	: source(nullptr), next(begin), end(end), bits(0), count(0), padding(0)
+{}
+
+inline BitReader::BitReader(ChunkReader &source)
+	: source(&source), next(nullptr), end(nullptr), bits(0), count(0), padding(0)
+{}
+
+inline void BitReader::refill()
+{
+	// Branchless refill: 8 bytes are loaded and as many whole ones as fit are consumed
+	// (bits of partially loaded byte are the same when it is loaded again)
+	if (end - next >= 8)
+	{
+		uint64_t word;
+		std::memcpy(&word, next, sizeof(word));
+#if defined(__GNUC__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+		word = __builtin_bswap64(word);
+#elif !defined(__GNUC__)
+		const uint8_t *b = next;
+		word = uint64_t(b[0]) << 56 | uint64_t(b[1]) << 48 | uint64_t(b[2]) << 40 | uint64_t(b[3]) << 32
+			| uint64_t(b[4]) << 24 | uint64_t(b[5]) << 16 | uint64_t(b[6]) << 8 | uint64_t(b[7]);
+#endif
+		bits |= word >> count;
+		next += (63 - count) >> 3;
+		count |= 56;
+	}
+	else
+		refillTail();
+}
+
+inline uint32_t BitReader::peek(unsigned int length) const
+{
+	return static_cast<uint32_t>(bits >> (64 - length));
+}
+
+inline void BitReader::consume(unsigned int length)
+{
+	bits <<= length;
+	count -= length;
+}
+
+inline bool BitReader::get()
+{
+	if (count == 0)
+		refill();
+	const bool bit = (bits >> 63) != 0;
+	consume(1);
+	return bit;
+}
+
+inline bool BitReader::vaild() const
+{
+	return count >= padding;
+}
+
+#endif // !BIT_STREAM_H
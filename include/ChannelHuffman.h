@@ -0,0 +1,136 @@
+#ifndef CHANNEL_HUFFMAN_H
+#define CHANNEL_HUFFMAN_H
+
+#include "Image.h"
+
+#include <vector>
+#include <array>
+#include <fstream>
+#include <cstdint>
+#include <type_traits> // integral_constant
+
+/**
+ * Huffman coding of every 4 bit color component with its own table of 16 codes,
+ * components are coded as differences from predicted ones (left or upper neighbour)
+ * Remarks: tables are tiny (fixed size header and look up tables in L1 cache), which suits
+ *          photos with many colors better than codes of whole pixels
+ */
+class ChannelHuffman
+{
+public:
+
+	// Prediction of every component from already coded neighbours
+	enum class Predictor : uint8_t
+	{
+		None, // components are coded as they are
+		Left,
+		Up,
+		Average // average of left and upper neighbour
+	};
+
+	// Limit of code's length (all three codes of pixel are looked up in 24 following bits)
+	static constexpr unsigned int max_length = 8u;
+
+	// Number of values of component
+	static constexpr unsigned int symbols = 16u;
+
+private:
+
+	// Number of every difference of every component (red, green, blue)
+	using Counts = std::array<std::array<uint32_t, symbols>, 3>;
+
+	Predictor predictor;
+
+	// Lengths of codes of every channel (red, green, blue)
+	std::array<std::vector<uint8_t>, 3> lengths;
+
+	/**
+	 * @param row of pixels
+	 * @param upper row (nullptr for the first one)
+	 * @param position in row
+	 * @return predicted pixel (every component separately), the first row uses left neighbour,
+	 *         the first column upper one
+	 */
+	template <Predictor P>
+	static uint16_t predict(const uint16_t *row, const uint16_t *above, unsigned int x);
+
+	/**
+	 * Calls fn with predictor as compile time constant (std::integral_constant),
+	 * so rows are coded by inlined loop
+	 */
+	template <typename Fn>
+	void dispatch(Fn &&fn) const;
+
+	// @return differences of components from predicted ones (modulo 16)
+	static uint16_t residual(uint16_t pixel, uint16_t predicted);
+
+	// @return pixel from differences of components
+	static uint16_t restore(uint16_t residual, uint16_t predicted);
+
+	/**
+	 * Chooses predictor giving the smallest entropy of differences
+	 * @return counts of differences with chosen predictor
+	 */
+	Counts choosePredictor(const Image &);
+
+	// Computes lengths of codes from counts of differences
+	void buildLengths(const Counts &counts);
+
+public:
+
+	ChannelHuffman();
+
+	// Public interface (predictor is chosen and saved by encoder)
+	void encode(std::ofstream &, const Image &);
+	void decode(std::ifstream &, Image &);
+};
+
+//------------------------------INLINE DEFINITIONS------------------------------
+// Remarks: they are called for every pixel, so they are kept in header
+
+template <ChannelHuffman::Predictor P>
+inline uint16_t ChannelHuffman::predict(const uint16_t *row, const uint16_t *above, unsigned int x)
+{
+	if (above == nullptr)
+		return x ? row[x - 1] : 0;
+	if (x == 0)
+		return above[0];
+
+	switch (P)
+	{
+	case Predictor::Left:
+		return row[x - 1];
+	case Predictor::Up:
+		return above[x];
+	case Predictor::Average:
+	{
+		// Components are averaged at once (the lowest bits are masked out, so they don't carry)
+		const uint16_t left = row[x - 1], up = above[x];
+		return static_cast<uint16_t>((left & up) + (((left ^ up) & 0x0EEE) >> 1));
+	}
+	default:
+		return 0;
+	}
+}
+
+template <typename Fn>
+inline void ChannelHuffman::dispatch(Fn &&fn) const
+{
+	switch (predictor)
+	{
+	case Predictor::None:
+		fn(std::integral_constant<Predictor, Predictor::None>());
+		break;
+	case Predictor::Left:
+		fn(std::integral_constant<Predictor, Predictor::Left>());
+		break;
+	case Predictor::Up:
+		fn(std::integral_constant<Predictor, Predictor::Up>());
+		break;
+	case Predictor::Average:
+		fn(std::integral_constant<Predictor, Predictor::Average>());
+		break;
+	}
+}
+
+#endif // !CHANNEL_HUFFMAN_H
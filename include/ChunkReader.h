@@ -0,0 +1,94 @@
+#ifndef CHUNK_READER_H
+#define CHUNK_READER_H
+
+#include <fstream>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Reads rest of file in fixed size chunks, the next one is read in background (by one thread
+ * running as long as the reader) while the current one is decoded (memory for input doesn't depend on file size)
+ * Remarks: file must not be read by anything else while the reader exists
+ */
+class ChunkReader
+{
+public:
+
+	// Default size of one chunk
+	static constexpr size_t default_chunk_size = 256u << 10;
+
+private:
+
+	std::ifstream &file;
+	size_t chunkSize;
+
+	// Chunk being decoded and the one read in background
+	std::vector<uint8_t> current, prefetched;
+
+	// Thread reading chunks to prefetched one (guarded by mutex)
+	std::thread reader;
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool ready;    // prefetched chunk is read and not taken yet
+	bool stopping; // reader is destroyed before the end of file
+	std::exception_ptr error;
+
+	// The last (not full) chunk was taken
+	bool finished;
+
+	// Not consumed bytes of current chunk
+	const uint8_t *position, *last;
+
+	// Main function of reading thread - reads chunks until the end of file
+	void work();
+
+	// Moves to next chunk
+	// @return false at the end of file
+	bool next();
+
+public:
+
+	explicit ChunkReader(std::ifstream &, size_t chunkSize = default_chunk_size);
+
+	ChunkReader(const ChunkReader &) = delete;
+	ChunkReader& operator=(const ChunkReader &) = delete;
+
+	// Stops reading in background
+	~ChunkReader();
+
+	/**
+	 * @param byte to read to
+	 * @return false at the end of file
+	 */
+	bool get(uint8_t &byte);
+
+	/**
+	 * @param memory to read to
+	 * @param number of bytes
+	 * @return number of read bytes (less than wanted only at the end of file)
+	 */
+	size_t read(uint8_t *bytes, size_t length);
+
+	/**
+	 * Consumes all not consumed bytes of current chunk (or next one if there are none)
+	 * @return range of bytes valid until next call | empty range at the end of file
+	 */
+	std::pair<const uint8_t *, const uint8_t *> take();
+};
+
+inline bool ChunkReader::get(uint8_t &byte)
+{
+	if (position == last && !next())
+		return false;
+
+	byte = *position++;
+	return true;
+}
+
+#endif // !CHUNK_READER_H
@@ -0,0 +1,50 @@
+#ifndef COLOR_TRANSFORM_H
+#define COLOR_TRANSFORM_H
+
+#include "Image.h"
+#include "Histogram.h"
+
+#include <array>
+#include <cstdint>
+
+/**
+ * Reversible color transform of RGB444 pixels (YCoCg-R lifting steps computed modulo 16),
+ * so correlated components become luma and two small chroma differences
+ * Remarks: every component stays 4 bit, so transformed Image can be saved by any algorithm
+ */
+class ColorTransform
+{
+private:
+
+	// @return half (rounded down) of component interpreted as signed (-8 - 7) value, modulo 16
+	static unsigned int half(unsigned int component);
+
+	// Transformed value of every RGB444 value and the inverse one
+	static const std::array<uint16_t, Histogram::size>& forwardTable();
+	static const std::array<uint16_t, Histogram::size>& inverseTable();
+
+	// Replaces every pixel by its value in table (rows are processed in parallel)
+	static void map(Image &image, const std::array<uint16_t, Histogram::size> &table);
+
+public:
+
+	/**
+	 * @param RGB444 value (0x0RGB)
+	 * @return transformed value (luma, green chroma and orange chroma in place of red, green and blue)
+	 */
+	static uint16_t forward(uint16_t rgb);
+
+	/**
+	 * @param transformed value
+	 * @return RGB444 value
+	 */
+	static uint16_t inverse(uint16_t transformed);
+
+	// Transforms pixels of RGB444 Image (copies pixels shared with other Image first)
+	static void apply(Image &image);
+
+	// Restores RGB444 pixels of transformed Image
+	static void revert(Image &image);
+};
+
+#endif // !COLOR_TRANSFORM_H
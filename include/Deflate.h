@@ -0,0 +1,92 @@
+#ifndef DEFLATE_H
+#define DEFLATE_H
+
+#include "Image.h"
+#include "LZ77.h"
+#include "Histogram.h"
+#include "BitStream.h"
+
+#include <vector>
+#include <fstream>
+#include <cstdint>
+
+/**
+ * LZ77 of whole pixels with Huffman coded tokens (like Deflate) - literal colors and lengths
+ * of sequences share one alphabet, distances of sequences have another one, long values are
+ * split into code and extra bits
+ * Remarks: sequences can be long and far (the previous row too), unlike fixed LZ77 codes,
+ *          Image can have at most 2^32 - 2 pixels (RuntimeError is thrown otherwise)
+ */
+class Deflate
+{
+public:
+
+	// The shortest coded sequence of pixels
+	static constexpr unsigned int min_sequence = 3u;
+
+	// The longest coded sequence of pixels
+	static constexpr unsigned int max_sequence = 1u << 16;
+
+	// The farthest beginning of sequence (in pixels)
+	static constexpr size_t max_distance = 1u << 20;
+
+	// Limit of code's length (lengths are saved in 4 bits)
+	static constexpr unsigned int max_length = 15u;
+
+private:
+
+	// Number of codes of lengths (after colors) and distances
+	static constexpr unsigned int length_codes = 32u;
+	static constexpr unsigned int distance_codes = 40u;
+
+	// Bits of hash of the first pixels of sequence
+	static constexpr unsigned int hash_bits = 16u;
+
+	// One literal color (length 0) or sequence
+	struct Token
+	{
+		uint32_t length;
+		uint32_t value; // color or distance
+	};
+
+	// Compression level (number of searched previous sequences with the same hash)
+	LZ77::Level level;
+
+	/**
+	 * Splits value to code and extra bits - values 0 - 3 have own codes,
+	 * others have 2 codes for every highest bit
+	 * @return { code, number of extra bits }
+	 */
+	static std::pair<unsigned int, unsigned int> valueCode(uint32_t value);
+
+	// @return the lowest value of code (extra bits are added to it)
+	static uint32_t codeBase(unsigned int code);
+
+	// @return number of extra bits after code
+	static unsigned int extraBits(unsigned int code);
+
+	// Finds sequences in pixels
+	std::vector<Token> tokenize(const std::vector<uint16_t> &pixels, unsigned int width) const;
+
+	/**
+	 * Save/load lengths of codes (4 bits each, 0 is followed by 8 bits of run of lengths 0)
+	 * @param writer/reader of bits
+	 * @param lengths of codes of all symbols
+	 */
+	static void saveLengths(BitWriter &writer, const std::vector<uint8_t> &lengths);
+	static void readLengths(BitReader &reader, std::vector<uint8_t> &lengths);
+
+	// @return lengths of codes limited to max_length (0 for not appeared symbols)
+	static std::vector<uint8_t> codeLengths(const std::vector<uint32_t> &freqs);
+
+public:
+
+	// @param compression level (not needed to decode)
+	Deflate(LZ77::Level = LZ77::Level::Fast);
+
+	// Public interface
+	void encode(std::ofstream &, const Image &);
+	void decode(std::ifstream &, Image &);
+};
+
+#endif // !DEFLATE_H
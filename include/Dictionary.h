@@ -0,0 +1,76 @@
+#ifndef DICTIONARY_H
+#define DICTIONARY_H
+
+#include "Image.h"
+#include "Histogram.h"
+
+#include <array>
+#include <vector>
+#include <string>
+
+// Statistics trained on sample images, shared by files of similar images (referenced by ID)
+// - Huffman codes built from colors of all sample images (no table saved in the file)
+// - the most common color which fills LZ77 search buffer before the first nibble
+class Dictionary
+{
+private:
+
+	uint32_t identifier;
+
+	// Colors of all added images (only while training)
+	std::array<uint64_t, Histogram::size> counts;
+
+	// Frequency of every color (at least 1, so any color can be coded)
+	std::array<uint32_t, Histogram::size> frequencies;
+
+	uint16_t color;
+
+	// Limit of Huffman codes' length
+	unsigned int codeLength;
+
+	// Computes frequencies, the most common color and ID from counted colors
+	void finish();
+
+	// Verifying string saved at the beginning of file
+	std::string extension() const;
+
+public:
+
+	/**
+	 * Empty dictionary (to train or load)
+	 * @param limit of Huffman codes' length
+	 */
+	Dictionary(unsigned int codeLength);
+
+	/**
+	 * Counts colors of sample Image
+	 * @param Image in RGB444 format
+	 */
+	void add(const Image &);
+
+	/**
+	 * Saves trained dictionary
+	 * @throws RuntimeError
+	 */
+	void save(const std::string &filename);
+
+	/**
+	 * Loads trained dictionary
+	 * @throws RuntimeError
+	 */
+	void load(const std::string &filename);
+
+	// @return ID saved in files which uses this dictionary (hash of its content)
+	uint32_t id() const;
+
+	// @return pairs of color and its frequency (every possible color)
+	std::vector<std::pair<uint32_t, uint32_t>> colorFreqs() const;
+
+	// @return the most common RGB444 color
+	uint16_t commonColor() const;
+
+	// @return limit of Huffman codes' length
+	unsigned int huffmanLength() const;
+};
+
+#endif // !DICTIONARY_H
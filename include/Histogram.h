@@ -0,0 +1,61 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include "Image.h"
+
+#include <array>
+
+// Direct-mapped histogram of RGB444 colors (one counter per each possible color)
+// Remarks: Only for 2 bytes per pixel Image (otherwise undefined behaviour)
+class Histogram
+{
+public:
+
+	// Number of all possible RGB444 colors
+	static constexpr size_t size = 4096u;
+
+	// Minimal number of rows counted by one thread
+	static constexpr size_t rows_per_chunk = 64u;
+
+private:
+
+	std::array<uint32_t, size> counts;
+
+	// Number of counted pixels
+	size_t pixels;
+
+public:
+
+	Histogram();
+
+	/**
+	 * Counts colors of the Image
+	 * @param Image to count colors of
+	 * @param size_t count only every n-th row (sampling)
+	 */
+	Histogram(const Image &, size_t rowStep = 1);
+
+	/**
+	 * @param color (12 bit)
+	 * @return number of pixels with given color
+	 */
+	uint32_t operator[](uint32_t color) const;
+
+	/**
+	 * @return number of counted pixels
+	 */
+	size_t total() const;
+
+	/**
+	 * @return number of distinct colors
+	 */
+	size_t colors() const;
+
+	/**
+	 * Shannon entropy of counted colors
+	 * @return double average number of bits needed per pixel
+	 */
+	double entropy() const;
+};
+
+#endif // !HISTOGRAM_H
@@ -3,24 +3,60 @@
 
 #include "Image.h"
 #include "Node.h"
+#include "Dictionary.h"
 
 #include <vector>
 #include <fstream>
 
 class Huffman
 {
+public:
+
+	// Default limit of code's length (short enough to decode codes with one table look up)
+	static constexpr unsigned int default_max_length = 15u;
+
+	// The longest allowed limit of code's length (size of decoding table is 2^limit)
+	static constexpr unsigned int max_length_limit = 16u;
+
+	// Number of bit streams decoded together when interleaved
+	static constexpr unsigned int streams = 4u;
+
+	// Number of pixels in one block of interleaved streams (multiple of streams)
+	static constexpr unsigned int stream_block = 1u << 16;
+
 private:
+
+	// Position of length limit saved in header's number of colors
+	static constexpr unsigned int limit_shift = 24u;
+
 	std::vector<std::pair<uint32_t, std::vector<bool>>> codeVec;
 	std::vector<std::pair<uint32_t, uint32_t>> colorFreqs;
 
+	// Limit of code's length set by user (0 for not limited codes)
+	unsigned int maxLength;
+
+	// Limit of code's length used by current codes (0 for codes from not limited tree)
+	unsigned int lengthLimit;
+
+	// Codes are split into interleaved streams
+	bool interleaved;
+
+	// Shared colors' frequencies used instead of saved ones (when set)
+	const Dictionary *dictionary;
+
 	// Empty huffman data;
 	void clear();
 
 	// Huffman algorithm's methods
 	void countFreq(const Image &);
+	void useDictionary();
 	void generateCodes(const Node *node, std::vector<bool> &code);
 	void buildTree();
 
+	// Creates canonical codes (ordered by length and color) with lengths not longer than lengthLimit
+	// Remarks: lengths come from limitedLengths() and codes from canonicalCodes()
+	void buildLimitedCodes();
+
 	// Debug
 	void printCodes() const;
 
@@ -28,12 +64,62 @@ private:
 	void saveHuffHeader(std::ofstream &ofile) const;
 	void readHuffHeader(std::ifstream &ifile);
 
+	// @return code (in the lowest bits) and its length for every color
+	std::vector<std::pair<uint32_t, unsigned int>> encodingTable() const;
+
+	// @return length of the longest code
+	unsigned int longestCode() const;
+
+	/**
+	 * @param number of bits looked up at once (at least the longest code)
+	 * @return color and length of code for every possible following bits (lookupTable() of encodingTable())
+	 */
+	std::vector<std::pair<uint16_t, uint8_t>> decodingTable(unsigned int bits) const;
+
 	// Save/load data from/to file
 	void saveCodes(std::ofstream &ofile, const Image &) const;
 	void readCodes(std::ifstream &ifile, Image &);
 
+	/**
+	 * Save/load data split into interleaved streams (pixel i is in stream i % streams),
+	 * every stream_block pixels are saved as a block - sizes of its streams followed by them
+	 * Remarks: only one block is read at once, so memory for input doesn't depend on file size
+	 */
+	void saveStreams(std::ofstream &ofile, const Image &) const;
+	void readStreams(std::ifstream &ifile, Image &);
+
 public:
-	Huffman();
+
+	/**
+	 * @param limit of code's length in bits (at most max_length_limit) | 0 for not limited codes
+	 * @param split codes into interleaved streams (decoded together), decoder has to use the same
+	 * @param trained dictionary (its codes are used and not saved), decoder has to use the same
+	 * Remarks: limit is raised when there is too many colors to code with it,
+	 *          interleaved streams always use limited codes
+	 */
+	Huffman(unsigned int maxLength = default_max_length, bool interleaved = false, const Dictionary *dictionary = nullptr);
+
+	/**
+	 * Computes lengths of codes not longer than limit (package-merge algorithm)
+	 * @param colors and their frequencies (the same order gives the same lengths)
+	 * @param limit of code's length (2^limit must be at least number of colors)
+	 * @return lengths of codes in order of colors (empty when there is no color)
+	 */
+	static std::vector<unsigned int> limitedLengths(const std::vector<std::pair<uint32_t, uint32_t>> &colorFreqs, unsigned int limit);
+
+	/**
+	 * Creates canonical codes (shorter first, the same length ordered by symbol)
+	 * @param length of code for every symbol (0 when it has none)
+	 * @return code (in the lowest bits) and its length for every symbol
+	 */
+	static std::vector<std::pair<uint32_t, uint8_t>> canonicalCodes(const std::vector<uint8_t> &lengths);
+
+	/**
+	 * @param codes of symbols (from canonicalCodes)
+	 * @param number of bits looked up at once (at least the longest code)
+	 * @return symbol and length of code for every possible following bits (0 length when there is none)
+	 */
+	static std::vector<std::pair<uint16_t, uint8_t>> lookupTable(const std::vector<std::pair<uint32_t, uint8_t>> &codes, unsigned int bits);
 
 	// Public interface
 	void encode(std::ofstream &, const Image &);
@@ -24,7 +24,9 @@ protected:
 	/// (they do NOT modify the object directly - so they are const)
 
 	/**
-	 * Creates an empty SDL_Surface (RGB) with paramters
+	 * Creates an empty SDL_Surface (RGB) with paramters or reuses released one (SurfacePool)
+	 * Remarks: pixels of reused surface are not cleared, rows of every surface
+	 *          are aligned and padded (PixelBuffer::default_alignment, default_padding)
 	 * @param width of the surface
 	 * @param height of the surface
 	 * @param color depth of the surface (number of bits each pixel takes in memory)
@@ -42,25 +44,26 @@ protected:
 
 public:
 
-	class pixel_iterator
+	// Iterator which only reads pixels (const Image can share them with other Images)
+	class const_pixel_iterator
 	{
-	private:
+	protected:
 		SDL_Surface *s;
 		size_t x, y;
 		uint8_t *current;
 
 	public:
-		pixel_iterator(SDL_Surface *surface);
-		pixel_iterator(SDL_Surface *surface, size_t x, size_t y);
+		const_pixel_iterator(SDL_Surface *surface);
+		const_pixel_iterator(SDL_Surface *surface, size_t x, size_t y);
 
-		pixel_iterator(const pixel_iterator& ) = default;
-		pixel_iterator(pixel_iterator &&) = default;
-		pixel_iterator& operator=(const pixel_iterator &) = default;
-		pixel_iterator& operator=(pixel_iterator &&) = default;
-		~pixel_iterator() = default;
+		const_pixel_iterator(const const_pixel_iterator& ) = default;
+		const_pixel_iterator(const_pixel_iterator &&) = default;
+		const_pixel_iterator& operator=(const const_pixel_iterator &) = default;
+		const_pixel_iterator& operator=(const_pixel_iterator &&) = default;
+		~const_pixel_iterator() = default;
 
-		pixel_iterator& operator++(); // pre increment
-		pixel_iterator operator++(int); // post increment
+		const_pixel_iterator& operator++(); // pre increment
+		const_pixel_iterator operator++(int); // post increment
 
 		/**
 		 * Gets current [x, y] coordinates on SDL_Surface
@@ -114,6 +117,27 @@ public:
 		 */
 		SDL_Color color2() const;
 
+		// Operators 
+		bool operator==(const const_pixel_iterator& it) const;
+		bool operator!=(const const_pixel_iterator& it) const;
+		bool operator<(const const_pixel_iterator& it) const;
+
+	};
+
+	// Iterator which also modifies pixels (got only from non-const Image, after detach())
+	class pixel_iterator : public const_pixel_iterator
+	{
+	public:
+		pixel_iterator(SDL_Surface *surface);
+		pixel_iterator(SDL_Surface *surface, size_t x, size_t y);
+
+		pixel_iterator& operator++(); // pre increment
+		pixel_iterator operator++(int); // post increment
+
+		// Getters (hidden by setters of the same name otherwise)
+		using const_pixel_iterator::value;
+		using const_pixel_iterator::value2;
+
 		/**
 		 * Sets pixel's data to SDL_Surface
 		 * @param pixel data (32 bits)
@@ -125,7 +149,7 @@ public:
 		 *
 		 * Remarks: Only for 2 bytes per pixel Image (otherwise undefined behaviour)
 		 */
-		void value2(uint32_t RGB2) const;
+		void value2(uint32_t RGB2);
 
 		/**
 		 * Sets pixel's color's data to SDL_Surface (Doesn't work with PALLETIZED SDL_Surface)
@@ -136,16 +160,43 @@ public:
 		 * Remarks: Only for 2 bytes per pixel Image (otherwise undefined behaviour)
 		 */
 		void value2(uint8_t R4, uint8_t G4, uint8_t B4);
-		
-		// Operators 
-		bool operator==(const pixel_iterator& it) const;
-		bool operator!=(const pixel_iterator& it) const;
-		bool operator<(const pixel_iterator& it) const;
-
 	};
 
-	pixel_iterator begin() const;
-	pixel_iterator end() const;
+	/// Non-const accessors detach the Image from shared pixel data first (copy-on-write),
+	/// const ones give only read only iterators
+
+	pixel_iterator begin();
+	pixel_iterator end();
+	const_pixel_iterator begin() const;
+	const_pixel_iterator end() const;
+
+	/**
+	 * @param x coordinate of pixel
+	 * @param y coordinate of pixel
+	 * @return iterator pointing at [x, y] pixel
+	 */
+	pixel_iterator at(size_t x, size_t y);
+	const_pixel_iterator at(size_t x, size_t y) const;
+
+	/**
+	 * @param y coordinate of row
+	 * @return pointer to pixel data of the row (first pixel)
+	 */
+	uint8_t* row(unsigned int y);
+	const uint8_t* row(unsigned int y) const;
+
+	/**
+	 * Makes own copy of pixel data when it is shared with other Image
+	 * Remarks: called by non-const accessors, so it is needed only before
+	 *          modifying pixels from many threads at once
+	 * @throws RuntimError when allocation fails
+	 */
+	void detach();
+
+	/**
+	 * @return bool true if pixel data is shared with other Image
+	 */
+	bool shared() const;
 
 	// Default constructor
 	Image();
@@ -163,6 +214,8 @@ public:
 	Image(const SDL_Surface *copied_surface);
 
 	// Copy constructor
+	// Remarks: pixel data is shared (refcounted SDL_Surface) until one of Images modifies it,
+	//          references are counted atomically (Images sharing it can be used by different threads)
 	Image(const Image &);
 
 	// Move constructor
@@ -9,9 +9,12 @@
 // [I]mage [V]iew and [I]nput/[O]utput [O]perations [H]andler
 class ImageHandler
 {
-private:
+protected:
+
+	virtual void store(const std::string &, const Image &) const = 0;
+	virtual Image recover(const std::string &) = 0;
 
-	/// Utility functions
+	/// Utility functions for derieved class
 
 	/**
 	 * Verifies extension of file
@@ -21,13 +24,6 @@ private:
 	 */
 	bool verifyExtension(const std::string &, const std::string &) const;
 
-protected:
-
-	virtual void store(const std::string &, const Image &) const = 0;
-	virtual Image recover(const std::string &) = 0;
-
-	/// Utility functions for derieved class
-
 	/**
 	 * Opens input file stream
 	 * @throws RuntimeError
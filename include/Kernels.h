@@ -0,0 +1,91 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+/**
+ * Row kernels chosen once by instruction set of the running CPU,
+ * so the same binary uses SIMD instructions where they are available
+ *
+ * Remarks: level can be forced with RGB12_CPU environment variable
+ *          or --cpu option (generic, sse4.2, avx2, avx512)
+ */
+class Kernels
+{
+public:
+
+	// Instruction set levels (every one includes previous ones)
+	enum class Level : uint8_t
+	{
+		Generic,
+		SSE42,
+		AVX2,
+		AVX512
+	};
+
+	/**
+	 * Converts row of pixels to RGB444 values (4 lower bits of components are lost)
+	 * @param source pixels
+	 * @param converted pixels
+	 * @param number of pixels
+	 */
+	using ConvertRow = void (*)(const uint8_t *, uint16_t *, size_t);
+
+	// Row of 32 bit pixels (0xXXRRGGBB)
+	ConvertRow xrgb32;
+
+	// Row of 24 bit pixels (bytes in blue, green, red order)
+	ConvertRow bgr24;
+
+private:
+
+	Level selected;
+
+	explicit Kernels(Level);
+
+	// Kernels which can be replaced by force()
+	static Kernels& instance();
+
+	// Level forced by RGB12_CPU environment variable or the best one supported
+	static Level initial();
+
+public:
+
+	/**
+	 * Kernels used by the whole application (selected on first use)
+	 */
+	static const Kernels& active();
+
+	/**
+	 * @return the best level supported by CPU (and compiler)
+	 */
+	static Level detected();
+
+	/**
+	 * @return level of active kernels
+	 */
+	static Level level();
+
+	/**
+	 * Selects kernels of given level for the whole application
+	 * Remarks: not thread safe, so it should be called before processing images
+	 * @throws RuntimError when CPU doesn't support the level
+	 */
+	static void force(Level);
+
+	/**
+	 * @param name of level (generic, sse4.2, avx2, avx512)
+	 * @return level with given name
+	 * @throws RuntimError on unknown name
+	 */
+	static Level parse(const std::string &);
+
+	/**
+	 * @return name of level
+	 */
+	static const char* name(Level);
+};
+
+#endif // !KERNELS_H
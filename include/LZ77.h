@@ -1,11 +1,28 @@
 #ifndef LZ77_H
 #define LZ77_H
 #include "Image.h"
-#include <map>
+#include "Dictionary.h"
+#include <vector>
 #include <fstream>
 
 class LZ77
 {
+public:
+
+	// Order of pixels' nibbles in coded stream
+	enum class Layout : uint8_t
+	{
+		Interleaved, // R, G, B nibbles of every pixel
+		Planar // R nibbles of a row, then its G nibbles, then its B nibbles (row by row)
+	};
+
+	// Compression level (decoding is the same for every level)
+	enum class Level : uint8_t
+	{
+		Fast, // code nibbles in chosen layout
+		Best // code nibbles in layout needing the smallest number of codes (slower)
+	};
+
 private:
 	// size of search buffer
 	const unsigned int s_buff_size;
@@ -13,30 +30,61 @@ private:
 	// size of lookahead buffer
 	const unsigned int la_buff_size;
 
-	// search buffer
-	std::map <int, uint8_t> s_buff;
+	// maximal length of coded sequence
+	static constexpr unsigned int max_sequence = 9u;
 
-	// lookahead buffer
-	std::map <int, uint8_t> la_buff;
+	// number of rows decoded before they are stored
+	static constexpr unsigned int rows_per_block = 64u;
 
-	//encoding functions
-	short create_code(std::ofstream &ofile);
-	void load_la_buff(std::array<uint8_t, 3> &color, Image::pixel_iterator &current, const Image::pixel_iterator &end, short &what_color, int start = 0, int addition = 0);
-	void insert_elements_to_s_buff(short max_length, int &it);
+	// first byte with this bit set contains layout (first subpixel never has it set)
+	static constexpr uint8_t layout_marker = 0x80u;
+
+	// order of coded nibbles
+	Layout layout;
+
+	// compression level
+	Level level;
+
+	// trained dictionary (its color fills search buffer instead of the first nibble)
+	const Dictionary *dictionary;
 
 	/**
-	 * Deletes n first elements from the map
-	 * @param map<int, uint8_t> buffer 
-	 * @param size_t n
+	 * Gets nibbles placed right before coded ones (search buffer at the beginning)
+	 * Remarks: without dictionary it is filled with the first nibble, which is saved uncoded;
+	 *          with dictionary it is one nibble longer, so the first nibble can be coded too
+	 * @param first nibble of Image
+	 * @return vector<uint8_t> nibbles (values 0-15)
 	 */
-	void popFront(std::map<int, uint8_t> &buffer, size_t n);
+	std::vector<uint8_t> searchBuffer(uint8_t first) const;
 
-	//decoding functions
-	short read_code(uint8_t code);
-	void put_elements_into_s_buff(short length);
+	/**
+	 * Gets 4 bit color components of every pixel in chosen layout
+	 * @param Image to read
+	 * @return vector<uint8_t> nibbles (values 0-15)
+	 */
+	std::vector<uint8_t> loadNibbles(const Image &image) const;
+
+	/**
+	 * Sets pixels of rows from 4 bit color components in chosen layout
+	 * @param uint8_t* nibbles (values 0-15) of pixels starting with the first row
+	 * @param Image to write to
+	 * @param first row to set
+	 * @param number of rows
+	 */
+	void storeNibbles(const uint8_t *nibbles, Image &image, unsigned int firstRow, unsigned int rows) const;
+
+	//encoding functions
+	std::pair<unsigned int, unsigned int> find_sequence(const std::vector<uint8_t> &data, size_t position) const;
+	size_t count_codes(const std::vector<uint8_t> &data) const;
+	void create_code(std::ofstream &ofile, const std::vector<uint8_t> &data, size_t position, unsigned int length, unsigned int offset) const;
 
 public:
-	LZ77();
+	/**
+	 * @param order of coded nibbles (saved)
+	 * @param compression level
+	 * @param trained dictionary, decoder has to use the same
+	 */
+	LZ77(Layout = Layout::Interleaved, Level = Level::Fast, const Dictionary *dictionary = nullptr);
 	void encode(std::ofstream&, const Image &);
 	void decode(std::ifstream&, Image &);
 };
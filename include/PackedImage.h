@@ -0,0 +1,77 @@
+#ifndef PACKED_IMAGE_H
+#define PACKED_IMAGE_H
+
+#include "Image.h"
+
+#include <vector>
+#include <cstdint>
+
+/**
+ * RGB444 pixels packed without any padding (3 bytes for every 2 pixels),
+ * nibbles are in red, green, blue order (the same layout as BitDensity saves)
+ * Remarks: rows are not separated, so with odd width every other row begins in the middle of byte
+ * Remarks: it is only a working buffer of BitDensity (blocks of rows are packed while saving and
+ *          unpacked while loading), RGB12 always keeps its pixels in 16 bit Image
+ */
+class PackedImage
+{
+private:
+
+	std::vector<uint8_t> bytes;
+	unsigned int w, h;
+
+	// @return index of the first nibble of the row
+	size_t nibble(unsigned int y) const;
+
+public:
+
+	PackedImage();
+
+	// Creates cleared pixels
+	PackedImage(unsigned int width, unsigned int height);
+
+	/**
+	 * Packs pixels of RGB444 Image
+	 * Remarks: Only for 2 bytes per pixel Image (otherwise undefined behaviour)
+	 */
+	explicit PackedImage(const Image &);
+
+	/**
+	 * @return number of bytes needed to pack pixels
+	 */
+	static size_t size(unsigned int width, unsigned int height);
+
+	/**
+	 * Packs one row of pixels
+	 * @param y coordinate of row
+	 * @param RGB444 values of row's pixels (0x0RGB)
+	 * Remarks: rows sharing a byte must not be packed at the same time
+	 */
+	void packRow(unsigned int y, const uint16_t *pixels);
+
+	/**
+	 * Unpacks one row of pixels
+	 * @param y coordinate of row
+	 * @param RGB444 values of row's pixels (0x0RGB)
+	 */
+	void unpackRow(unsigned int y, uint16_t *pixels) const;
+
+	/**
+	 * @return RGB444 Image with unpacked pixels
+	 * @throws RuntimError when allocation fails
+	 */
+	Image image() const;
+
+	uint8_t *data();
+	const uint8_t *data() const;
+
+	/**
+	 * @return number of bytes of packed pixels
+	 */
+	size_t size() const;
+
+	unsigned int width() const;
+	unsigned int height() const;
+};
+
+#endif // !PACKED_IMAGE_H
@@ -0,0 +1,69 @@
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#include "Image.h"
+#include "Histogram.h"
+
+#include <vector>
+#include <array>
+#include <fstream>
+
+// Indexed colors algorithm for images with at most 256 distinct RGB444 colors
+class Palette
+{
+public:
+
+	// How indices of colors are saved after the palette
+	enum class Stage : uint8_t
+	{
+		Packed, // 1/2/4/8 bits per pixel
+		Huffman,
+		LZ77
+	};
+
+	// Maximal number of colors which can be indexed
+	static constexpr size_t max_colors = 256u;
+
+private:
+
+	Stage stage;
+
+	// Distinct colors of the Image
+	std::vector<uint32_t> colors;
+
+	// Index of every RGB444 color in the palette
+	std::array<uint8_t, Histogram::size> indices;
+
+	// @return number of bits needed to save one index (1, 2, 4 or 8)
+	unsigned int indexBits() const;
+
+	/**
+	 * Creates Image of the same size where every pixel's value is index of its color
+	 * (so it can be saved by other algorithms)
+	 */
+	Image indexImage(const Image &) const;
+
+	// Store/load palette needed to recover colors
+	void savePalette(std::ofstream &ofile) const;
+	void readPalette(std::ifstream &ifile);
+
+	// Save/load indices packed into bytes
+	void savePacked(std::ofstream &ofile, const Image &) const;
+	void loadPacked(std::ifstream &ifile, Image &) const;
+
+public:
+	Palette(Stage = Stage::Packed);
+
+	/**
+	 * Collects distinct colors of the Image
+	 * @return bool true if Image can be indexed | false when it has too many colors
+	 */
+	bool build(const Image &);
+
+	// Public interface
+	// Remarks: encode() builds palette if it wasn't built before
+	void encode(std::ofstream &, const Image &);
+	void decode(std::ifstream &, Image &);
+};
+
+#endif // !PALETTE_H
@@ -0,0 +1,107 @@
+#ifndef PIXEL_BUFFER_H
+#define PIXEL_BUFFER_H
+
+#include "SDL_Local.h"
+
+#include <cstdint>
+#include <cstddef>
+
+// Pixel data with aligned and padded rows (allocated by the application, not by SDL)
+// Remarks: SDL_Surface is only a view of the buffer, which can be created by surface()
+class PixelBuffer
+{
+public:
+
+	// Default alignment of every row (cache line, the widest SIMD register)
+	static constexpr size_t default_alignment = 64u;
+
+	// Default number of bytes after every row which can be read (one AVX2 register)
+	static constexpr size_t default_padding = 32u;
+
+	// Where pixel data is allocated
+	enum class Memory : uint8_t
+	{
+		Heap,
+		HugePages // Linux only (elsewhere or on failure Heap is used)
+	};
+
+private:
+
+	// Allocated block and the first aligned row in it
+	uint8_t *block;
+	uint8_t *pixels;
+	size_t allocated;
+	Memory placement;
+
+	unsigned int w, h, bytes;
+	size_t rowPitch;
+
+	// Frees allocated block
+	void deallocate();
+
+public:
+
+	PixelBuffer();
+
+	/**
+	 * Allocates cleared pixel data
+	 * @param width in pixels
+	 * @param height in pixels
+	 * @param number of bytes per pixel
+	 * @param alignment of every row (power of 2)
+	 * @param number of bytes after every row which can be read (e.g. by SIMD loads)
+	 * @param where pixel data is allocated
+	 * @throws RuntimError when allocation fails
+	 */
+	PixelBuffer(unsigned int width, unsigned int height, unsigned int bytesPerPixel,
+		size_t alignment = default_alignment, size_t padding = default_padding, Memory = Memory::Heap);
+
+	/**
+	 * Copies pixel data of surface (adapter from SDL)
+	 * @throws RuntimError when allocation fails
+	 */
+	static PixelBuffer from(const SDL_Surface *, size_t alignment = default_alignment, size_t padding = default_padding);
+
+	PixelBuffer(const PixelBuffer &) = delete;
+	PixelBuffer& operator=(const PixelBuffer &) = delete;
+	PixelBuffer(PixelBuffer &&);
+	PixelBuffer& operator=(PixelBuffer &&);
+	~PixelBuffer();
+
+	/**
+	 * Creates SDL_Surface using pixel data of the buffer (adapter to SDL, nothing is copied)
+	 * @param color depth (number of masks like SDL_CreateRGBSurface uses)
+	 * @return surface freed by SDL_FreeSurface, which must not outlive the buffer | nullptr on failure
+	 */
+	SDL_Surface *surface(unsigned int depth) const;
+
+	/**
+	 * @param y coordinate of row
+	 * @return pointer to the first pixel of the row (aligned)
+	 */
+	uint8_t *row(unsigned int y);
+	const uint8_t *row(unsigned int y) const;
+
+	unsigned int width() const;
+	unsigned int height() const;
+	unsigned int bytesPerPixel() const;
+
+	/**
+	 * @return distance between rows in bytes (multiple of alignment)
+	 */
+	size_t pitch() const;
+
+	/**
+	 * @return number of bytes of all rows
+	 */
+	size_t size() const;
+
+	/**
+	 * @return where pixel data is really allocated
+	 */
+	Memory memory() const;
+
+	bool empty() const;
+};
+
+#endif // !PIXEL_BUFFER_H
@@ -0,0 +1,177 @@
+#ifndef PIXELLAYOUT_H
+#define PIXELLAYOUT_H
+
+#include "SDL_Local.h"
+
+#include <cstdint>
+
+/**
+ * Layouts of pixel data with masks and shifts known at compile time
+ * Every layout gives color of pixel from pointer to its data, so loops written
+ * for any layout are fully inlined after dispatch() chooses one per Image
+ */
+namespace PixelLayout
+{
+	// 8 bit indices to palette of surface
+	struct Palette8
+	{
+		static constexpr unsigned int bytes = 1u;
+
+		const SDL_Palette *palette;
+
+		static bool matches(const SDL_PixelFormat *format)
+		{
+			return format->BytesPerPixel == bytes && format->palette != nullptr;
+		}
+
+		SDL_Color color(const uint8_t *pixel) const
+		{
+			return (*pixel < palette->ncolors) ? palette->colors[*pixel] : SDL_Color{ 0, 0, 0, 0 };
+		}
+	};
+
+	// 4 bits per component in 16 bit value (0x0RGB), used by every RGB12 Image
+	struct RGB444
+	{
+		static constexpr unsigned int bytes = 2u;
+
+		static constexpr uint32_t r_shift = 8u,
+			g_shift = 4u,
+			b_shift = 0u,
+			mask = 0x0Fu;
+
+		static bool matches(const SDL_PixelFormat *format)
+		{
+			return format->BytesPerPixel == bytes && format->palette == nullptr
+				&& format->Rmask == mask << r_shift && format->Gmask == mask << g_shift && format->Bmask == mask << b_shift;
+		}
+
+		static uint32_t value(const uint8_t *pixel)
+		{
+			return *reinterpret_cast<const uint16_t *>(pixel);
+		}
+
+		// @return 4 bit components (0x0 - 0xF)
+		static uint8_t r4(uint32_t value) { return static_cast<uint8_t>((value >> r_shift) & mask); }
+		static uint8_t g4(uint32_t value) { return static_cast<uint8_t>((value >> g_shift) & mask); }
+		static uint8_t b4(uint32_t value) { return static_cast<uint8_t>((value >> b_shift) & mask); }
+
+		static SDL_Color color(const uint8_t *pixel)
+		{
+			const uint32_t RGB = value(pixel);
+			return SDL_Color{ static_cast<uint8_t>(r4(RGB) << 4), static_cast<uint8_t>(g4(RGB) << 4), static_cast<uint8_t>(b4(RGB) << 4), 0 };
+		}
+
+		// @return pixel's value made from 8 bit components (4 lower bits are lost)
+		static uint16_t pack(uint8_t R, uint8_t G, uint8_t B)
+		{
+			return static_cast<uint16_t>((R >> 4) << r_shift | (G >> 4) << g_shift | (B >> 4) << b_shift);
+		}
+
+		static void store(uint8_t *pixel, uint16_t RGB)
+		{
+			*reinterpret_cast<uint16_t *>(pixel) = RGB;
+		}
+	};
+
+	// 3 bytes per pixel in blue, green, red order (24 bit BMP)
+	struct BGR24
+	{
+		static constexpr unsigned int bytes = 3u;
+
+		static bool matches(const SDL_PixelFormat *format)
+		{
+			return SDL_BYTEORDER == SDL_LIL_ENDIAN && format->BytesPerPixel == bytes && format->palette == nullptr
+				&& format->Rmask == 0x00FF0000u && format->Gmask == 0x0000FF00u && format->Bmask == 0x000000FFu;
+		}
+
+		static SDL_Color color(const uint8_t *pixel)
+		{
+			return SDL_Color{ pixel[2], pixel[1], pixel[0], 0 };
+		}
+	};
+
+	// 32 bit value with 8 bits per component (0xXXRRGGBB, 32 bit BMP)
+	struct XRGB32
+	{
+		static constexpr unsigned int bytes = 4u;
+
+		static bool matches(const SDL_PixelFormat *format)
+		{
+			return format->BytesPerPixel == bytes && format->palette == nullptr
+				&& format->Rmask == 0x00FF0000u && format->Gmask == 0x0000FF00u && format->Bmask == 0x000000FFu;
+		}
+
+		static SDL_Color color(const uint8_t *pixel)
+		{
+			const uint32_t RGB = *reinterpret_cast<const uint32_t *>(pixel);
+			return SDL_Color{ static_cast<uint8_t>(RGB >> 16), static_cast<uint8_t>(RGB >> 8), static_cast<uint8_t>(RGB), 0 };
+		}
+	};
+
+	// Any other format read through SDL_PixelFormat (like Image::pixel_iterator::color())
+	struct Generic
+	{
+		const SDL_PixelFormat *format;
+		unsigned int bytes;
+
+		explicit Generic(const SDL_PixelFormat *format)
+			: format(format), bytes(format->BytesPerPixel)
+		{}
+
+		SDL_Color color(const uint8_t *pixel) const
+		{
+			uint32_t RGB = 0;
+			switch (bytes)
+			{
+			case 1:
+				RGB = *pixel;
+				break;
+			case 2:
+				RGB = *reinterpret_cast<const uint16_t *>(pixel);
+				break;
+			case 3:
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+				RGB = pixel[0] << 16 | pixel[1] << 8 | pixel[2];
+#else
+				RGB = pixel[0] | pixel[1] << 8 | pixel[2] << 16;
+#endif
+				break;
+			case 4:
+				RGB = *reinterpret_cast<const uint32_t *>(pixel);
+				break;
+			}
+
+			if (format->palette != nullptr)
+				return (RGB < static_cast<uint32_t>(format->palette->ncolors)) ? format->palette->colors[RGB] : SDL_Color{ 0, 0, 0, 0 };
+
+			return SDL_Color{
+				static_cast<uint8_t>(((RGB & format->Rmask) >> format->Rshift) << format->Rloss),
+				static_cast<uint8_t>(((RGB & format->Gmask) >> format->Gshift) << format->Gloss),
+				static_cast<uint8_t>(((RGB & format->Bmask) >> format->Bshift) << format->Bloss),
+				0 };
+		}
+	};
+
+	/**
+	 * Calls function with layout matching the format (once per Image, not per pixel)
+	 * @param format of surface
+	 * @param function taking any layout (e.g. generic lambda with const auto &)
+	 */
+	template<class Function>
+	void dispatch(const SDL_PixelFormat *format, Function &&function)
+	{
+		if (Palette8::matches(format))
+			function(Palette8{ format->palette });
+		else if (RGB444::matches(format))
+			function(RGB444{});
+		else if (BGR24::matches(format))
+			function(BGR24{});
+		else if (XRGB32::matches(format))
+			function(XRGB32{});
+		else
+			function(Generic(format));
+	}
+}
+
+#endif // !PIXELLAYOUT_H
@@ -2,8 +2,13 @@
 #define RGB12_H
 
 #include "BMP.h"
+#include "Palette.h"
+#include "LZ77.h"
+#include "Histogram.h"
+#include "Dictionary.h"
 
 #include <tuple>
+#include <array>
 #include <fstream>
 
 class RGB12 : public ImageHandler
@@ -15,16 +20,50 @@ public:
 		BitDensity,
 		Huffman,
 		LZ77,
-		GrayScale
+		GrayScale,
+		Palette,
+		InterleavedHuffman, // Huffman codes split into streams decoded together
+		AdaptiveHuffman, // Huffman codes rebuilt while coding (one pass, no saved frequencies)
+		Deflate, // LZ77 of pixels with Huffman coded tokens
+		ANS, // table based asymmetric numeral system (fractional bits per pixel)
+		ChannelHuffman // Huffman codes of differences of every component from its neighbour
 	};
 
 	// Indicates which algorithm (defined in Algorithm enum) will be used for future saving process
 	// Remarks: stil can read images saved by other compatible algorithms
 	Algorithm algorithm;
 
+	// Indicates how palette indices are saved when Algorithm::Palette is chosen
+	// Remarks: Image with too many colors is saved with equivalent algorithm without palette
+	Palette::Stage paletteStage;
+
+	// Order of nibbles coded by Algorithm::LZ77 (saved in its header)
+	LZ77::Layout lz77Layout;
+
+	// Compression level of Algorithm::LZ77 and Algorithm::Deflate (not needed to decode)
+	LZ77::Level lz77Level;
+
+	// Trained dictionary used by Huffman and LZ77 algorithms if set (its ID is saved in header)
+	// Remarks: it is not owned, files saved with it can be loaded only with the same one set
+	const Dictionary *dictionary;
+
+	// Limit of codes' length used by Algorithm::Huffman (0 for not limited, saved in its header)
+	// Remarks: Algorithm::InterleavedHuffman and Algorithm::AdaptiveHuffman always use limited codes
+	unsigned int huffmanLength;
+
+	// Pixels are saved after reversible color transform (saved in header, combinable with any algorithm)
+	// Remarks: Algorithm::GrayScale is always saved without it
+	bool colorTransform;
+
 	// This class has undefined beheviour if "image.depth() != supported_depth"
 	static constexpr unsigned int supported_depth = 12u;
 
+	// Minimal number of rows converted by one thread (smaller Images aren't worth splitting)
+	static constexpr size_t rows_per_chunk = 64u;
+
+	// Default limit of relative encoding cost (BitDensity = 1) used by autoAlgorithm()
+	static constexpr unsigned int default_budget = 20u;
+
 	std::string extension() const override;
 	RGB12(Algorithm = Algorithm::BitDensity);
 	RGB12(const ImageHandler &img, Algorithm alg = Algorithm::BitDensity);
@@ -37,17 +76,79 @@ public:
 	// is chosen change to Algorithm::GreyScale
 	RGB12& toGrayScale();
 
+	/**
+	 * Samples the Image (histogram size, entropy, runs of repeated pixels, differences of components
+	 * from neighbours), estimates output size of every algorithm and chooses the smallest one within speed budget
+	 * @param unsigned int maximal relative encoding cost (BitDensity = 1)
+	 *
+	 * Remarks: Algorithm::GrayScale is considered only if it is already chosen (it is lossy),
+	 *          colorTransform is set when it makes Algorithm::ChannelHuffman smaller (other ones code
+	 *          whole colors or bytes, so they are estimated without it), Algorithm::AdaptiveHuffman
+	 *          and Algorithm::InterleavedHuffman are not considered (they aren't smaller than Huffman)
+	 */
+	RGB12& autoAlgorithm(unsigned int budget = default_budget);
+
+	/**
+	 * Saves Image of any format in gray scale (Algorithm::GrayScale) in one pass, every row
+	 * is converted to RGB444, turned to gray and packed right away (without copy of the Image)
+	 * Remarks: Output is the same as after RGB12(img).toGrayScale().save(filename)
+	 * @param Image in any format supported by Image::pixel_iterator::color()
+	 * @param string filename of output file (extension is added like in save())
+	 */
+	void saveGrayScale(const Image &img, std::string &filename) const;
+
 protected:
 	void store(const std::string &filename, const Image &image) const override;
 	Image recover(const std::string &filename) override;
 
-	std::tuple<unsigned int, unsigned int, Algorithm> readHeader(std::ifstream &input) const;
-	void writeHeader(std::ofstream &output, const Image &img, Algorithm alg) const;
+	// Bit of saved algorithm which means that byte with flags follows (older files don't have it)
+	static constexpr uint8_t flags_marker = 0x80u;
+
+	// Flags saved in header
+	static constexpr uint8_t dictionary_flag = 0x01u; // ID of used dictionary follows
+	static constexpr uint8_t transform_flag = 0x02u; // pixels were saved after ColorTransform
+
+	/**
+	 * @return { width, height, algorithm, flags }
+	 * @throws RuntimeError when file needs other dictionary than the set one
+	 */
+	std::tuple<unsigned int, unsigned int, Algorithm, uint8_t> readHeader(std::ifstream &input) const;
+	void writeHeader(std::ofstream &output, const Image &img, Algorithm alg, uint8_t flags = 0) const;
 
 private:
 
 	/// Utility functions
 
+	/**
+	 * Gray scale color of every RGB444 pixel value (computed once, like Image::pixel_iterator::gray2())
+	 * Remarks: RGB12 Image always uses 0x0F00, 0x00F0, 0x000F masks (SDL's RGB444 format)
+	 * @return array<uint8_t, 4096> indexed by 12 bit pixel value
+	 */
+	static const std::array<uint8_t, Histogram::size>& grayTable();
+
+	// @return number of bytes saved by save444() (compressed data never takes more)
+	static size_t storedSize(const Image &img);
+
+	// Number of every difference of every component (red, green, blue), used by autoAlgorithm()
+	using ChannelCounts = std::array<std::array<uint32_t, 16>, 3>;
+
+	// Counts differences of components of pixel from predicted one (modulo 16, like ChannelHuffman)
+	static void countDifferences(ChannelCounts &counts, uint16_t pixel, uint16_t predicted);
+
+	// @return average of every component of both pixels (rounded down)
+	static uint16_t average(uint16_t left, uint16_t up);
+
+	/**
+	 * @param counts of values
+	 * @param number of values
+	 * @param sum of counts
+	 * @return average number of bits needed by ideal codes
+	 */
+	static double entropy(const uint32_t *counts, size_t size, size_t total);
+
+	// @return bits per pixel of ChannelHuffman codes of counted differences
+	static double channelsBits(const ChannelCounts &counts);
+
 	/**
 	 * Creates new Image converted to set DEPTH (RGB12::DEPTH) 
 	 * @param Image input
@@ -72,6 +173,7 @@ private:
 	 */
 
 	 // Saves binary every pixel as 12 bit RGB (without spaces)
+	 // Remarks: store() falls back to it when other algorithm would save more bytes
 	void save444(std::ofstream &f, const Image &img) const;
 
 	// Loads pixel data from every pixel saved in RGB444 format (without spaces)
@@ -0,0 +1,107 @@
+#ifndef SURFACE_POOL_H
+#define SURFACE_POOL_H
+
+#include "SDL_Local.h"
+#include "PixelBuffer.h"
+
+#include <map>
+#include <unordered_map>
+#include <tuple>
+#include <vector>
+#include <mutex>
+
+// Keeps released surfaces (created by it) to reuse them for next Images of the same size
+// Remarks: Pixels of reused surface are not cleared, its rows are aligned and padded (PixelBuffer)
+class SurfacePool
+{
+public:
+
+	// Suggested size of pixel data kept for batches of images
+	static constexpr size_t default_limit = 256u << 20;
+
+	// Default minimal size of pixel data placed in huge pages
+	static constexpr size_t default_huge_threshold = 32u << 20;
+
+private:
+
+	// (width, height, depth)
+	using Key = std::tuple<unsigned int, unsigned int, unsigned int>;
+
+	// Released surfaces ready to reuse
+	std::map<Key, std::vector<SDL_Surface *>> released;
+
+	// Surface created by pool (view of its pixel data)
+	struct Owned
+	{
+		Key key;
+		PixelBuffer buffer;
+	};
+	std::unordered_map<SDL_Surface *, Owned> owned;
+
+	// Size of pixel data of released surfaces
+	size_t kept;
+
+	// Maximal size of pixel data of released surfaces (0 = nothing is kept)
+	size_t capacity;
+
+	// Minimal size of pixel data placed in huge pages (0 = not used)
+	size_t hugeThreshold;
+
+	std::mutex mutex;
+
+	// Frees surface and its pixel data
+	void destroy(SDL_Surface *surface);
+
+	// @return counter of references of surface (SDL's refcount changed atomically)
+	static SDL_atomic_t *references(const SDL_Surface *surface);
+
+public:
+
+	SurfacePool();
+	SurfacePool(const SurfacePool &) = delete;
+	SurfacePool& operator=(const SurfacePool &) = delete;
+	~SurfacePool();
+
+	/**
+	 * Pool used by every Image (created on first use, doesn't keep anything by default)
+	 */
+	static SurfacePool& shared();
+
+	/**
+	 * @param maximal size of pixel data kept to reuse | 0 to free surfaces immediately
+	 */
+	void limit(size_t bytes);
+
+	/**
+	 * @param minimal size of pixel data placed in huge pages | 0 to not use them
+	 * Remarks: Only on Linux, elsewhere surfaces are created as usual
+	 */
+	void hugePages(size_t threshold = default_huge_threshold);
+
+	/**
+	 * Reuses released surface or creates new one (like SDL_CreateRGBSurface, but with aligned rows)
+	 * @throws RuntimeError when allocation fails
+	 */
+	SDL_Surface *acquire(unsigned int width, unsigned int height, unsigned int depth);
+
+	/**
+	 * Keeps surface created by pool (if there is space) or frees it, when its last reference is released
+	 * Remarks: surfaces not created by pool are freed by SDL_FreeSurface
+	 */
+	void release(SDL_Surface *surface);
+
+	/**
+	 * Adds reference of surface shared by other Image
+	 * Remarks: references are counted atomically, so Images sharing surface can be copied,
+	 *          detached and destroyed by many threads (every Image only by one at once)
+	 */
+	static void retain(SDL_Surface *surface);
+
+	// @return number of Images sharing surface
+	static int count(const SDL_Surface *surface);
+
+	// Frees all kept surfaces
+	void clear();
+};
+
+#endif // !SURFACE_POOL_H
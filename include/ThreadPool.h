@@ -0,0 +1,64 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+// Fixed number of worker threads (one per core) running data-parallel loops
+class ThreadPool
+{
+private:
+
+	std::vector<std::thread> workers;
+
+	// Waiting tasks (guarded by mutex)
+	std::queue<std::function<void()>> tasks;
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool stopping;
+
+	// Main function of every worker - runs tasks until the pool is destroyed
+	void work();
+
+public:
+
+	/**
+	 * Starts worker threads
+	 * @param number of threads (with calling one) | 0 for number of cores
+	 */
+	explicit ThreadPool(unsigned int threads = 0);
+
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool& operator=(const ThreadPool &) = delete;
+
+	// Waits for workers to finish their tasks
+	~ThreadPool();
+
+	/**
+	 * Pool shared by the whole application (created on first use)
+	 */
+	static ThreadPool& shared();
+
+	/**
+	 * @return maximal number of chunks run at the same time (workers with calling thread)
+	 */
+	unsigned int threads() const;
+
+	/**
+	 * Splits range [begin, end) into contiguous chunks and runs them in parallel,
+	 * calling thread works too and returns when every chunk is done
+	 * @param begin of range (e.g. first row)
+	 * @param end of range
+	 * @param minimal size of chunk (smaller ranges are run on calling thread only)
+	 * @param function(chunk, chunkBegin, chunkEnd) where chunk is index lower than threads()
+	 *
+	 * Remarks: The first exception thrown by any chunk is rethrown after all of them finish
+	 */
+	void parallelFor(size_t begin, size_t end, size_t minChunk, const std::function<void(unsigned int, size_t, size_t)> &body);
+};
+
+#endif // !THREAD_POOL_H
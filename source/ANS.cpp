@@ -0,0 +1,331 @@
+#include "ANS.h"
+#include "ChunkReader.h"
+#include "RuntimeError.h"
+
+#include <iostream>
+#include <sstream>
+#include <algorithm> // sort, max
+
+namespace
+{
+	// @return index of the highest set bit
+	unsigned int highestBit(uint32_t value)
+	{
+		unsigned int bit = 0;
+		while (value >>= 1)
+			++bit;
+		return bit;
+	}
+}
+
+ANS::ANS(size_t alphabet)
+	: alphabet(alphabet), tableLog(0), state(0)
+{}
+
+unsigned int ANS::chooseTableLog(uint64_t total, size_t symbols)
+{
+	if (symbols > (size_t(1) << max_table_log))
+	{
+		std::ostringstream os;
+		os << "Too many symbols for ANS table (" << symbols << ").";
+		throw RuntimeError(os.str());
+	}
+
+	// Rare symbols need enough states to keep their share, but not more states than symbols are coded
+	unsigned int log = min_table_log;
+	while (log < max_table_log && (size_t(1) << log) < 8 * symbols && (uint64_t(1) << log) < total)
+		++log;
+	while ((size_t(1) << log) < symbols)
+		++log;
+	return log;
+}
+
+void ANS::normalize(const std::vector<uint32_t> &freqs, uint64_t total)
+{
+	const uint32_t size = 1u << tableLog;
+	norms.assign(alphabet, 0);
+
+	uint32_t sum = 0;
+	size_t largest = 0;
+	for (size_t symbol = 0; symbol < alphabet; ++symbol)
+	{
+		if (!freqs[symbol])
+			continue;
+
+		norms[symbol] = std::max<uint32_t>(1, static_cast<uint32_t>(freqs[symbol] * uint64_t(size) / total));
+		sum += norms[symbol];
+		if (freqs[symbol] > freqs[largest])
+			largest = symbol;
+	}
+
+	// Rounding error is given to (or taken from) the most common symbols
+	if (sum < size)
+		norms[largest] += size - sum;
+	if (sum > size)
+	{
+		std::vector<size_t> order;
+		for (size_t symbol = 0; symbol < alphabet; ++symbol)
+		{
+			if (norms[symbol] > 1)
+				order.push_back(symbol);
+		}
+		std::sort(order.begin(), order.end(), [this](size_t a, size_t b)
+		{
+			return norms[a] > norms[b] || (norms[a] == norms[b] && a < b);
+		});
+
+		while (sum > size)
+		{
+			for (auto symbol : order)
+			{
+				if (sum == size)
+					break;
+				if (norms[symbol] > 1)
+				{
+					--norms[symbol];
+					--sum;
+				}
+			}
+		}
+	}
+}
+
+std::vector<uint16_t> ANS::spread() const
+{
+	// Odd step visits every state once, so symbols are spread evenly over the table
+	const size_t size = size_t(1) << tableLog,
+		mask = size - 1,
+		step = (size >> 1) + (size >> 3) + 3;
+
+	std::vector<uint16_t> symbols(size, 0);
+	size_t position = 0;
+	for (size_t symbol = 0; symbol < alphabet; ++symbol)
+	{
+		for (uint32_t i = 0; i < norms[symbol]; ++i)
+		{
+			symbols[position] = static_cast<uint16_t>(symbol);
+			position = (position + step) & mask;
+		}
+	}
+	return symbols;
+}
+
+void ANS::buildEncoding()
+{
+	const uint32_t size = 1u << tableLog;
+	const std::vector<uint16_t> symbols = spread();
+
+	start.assign(alphabet, 0);
+	threshold.assign(alphabet, 0);
+	maxBits.assign(alphabet, 0);
+	uint32_t offset = 0;
+	for (size_t symbol = 0; symbol < alphabet; ++symbol)
+	{
+		start[symbol] = offset;
+		offset += norms[symbol];
+		if (norms[symbol])
+		{
+			maxBits[symbol] = static_cast<uint8_t>(tableLog - highestBit(norms[symbol]));
+			threshold[symbol] = norms[symbol] << maxBits[symbol];
+		}
+	}
+
+	// Occurrences of symbol in table (in order of states) are its next states
+	std::vector<uint32_t> filled(start);
+	states.assign(size, 0);
+	for (uint32_t u = 0; u < size; ++u)
+		states[filled[symbols[u]]++] = size + u;
+}
+
+void ANS::buildDecoding()
+{
+	const uint32_t size = 1u << tableLog;
+	const std::vector<uint16_t> symbols = spread();
+
+	// The same order of occurrences as in encoding table
+	std::vector<uint32_t> next(norms);
+	decoding.resize(size);
+	for (uint32_t u = 0; u < size; ++u)
+	{
+		const uint16_t symbol = symbols[u];
+		const uint32_t x = next[symbol]++;
+		const unsigned int bits = tableLog - highestBit(x);
+		decoding[u] = { static_cast<uint16_t>((x << bits) - size), symbol, static_cast<uint8_t>(bits) };
+	}
+}
+
+void ANS::build(const std::vector<uint32_t> &freqs)
+{
+	uint64_t total = 0;
+	size_t symbols = 0;
+	for (size_t symbol = 0; symbol < alphabet; ++symbol)
+	{
+		total += freqs[symbol];
+		if (freqs[symbol])
+			++symbols;
+	}
+	if (symbols == 0)
+		throw RuntimeError("Cannot build ANS table without symbols.");
+
+	tableLog = chooseTableLog(total, symbols);
+	normalize(freqs, total);
+	buildEncoding();
+}
+
+void ANS::saveTable(BitWriter &writer) const
+{
+	writer.put(tableLog, 4);
+
+	// Length of every frequency (5 bits) and its bits after the highest one,
+	// length 0 is followed by 8 bits of run of not appeared symbols
+	for (size_t symbol = 0; symbol < alphabet;)
+	{
+		if (norms[symbol])
+		{
+			const unsigned int bits = highestBit(norms[symbol]);
+			writer.put(bits + 1, 5);
+			writer.put(norms[symbol], bits);
+			++symbol;
+			continue;
+		}
+
+		size_t run = 1;
+		while (symbol + run < alphabet && run < 256 && norms[symbol + run] == 0)
+			++run;
+		writer.put(0, 5);
+		writer.put(static_cast<uint32_t>(run - 1), 8);
+		symbol += run;
+	}
+}
+
+void ANS::readTable(BitReader &reader)
+{
+	reader.refill();
+	tableLog = reader.peek(4);
+	reader.consume(4);
+	if (tableLog < min_table_log || tableLog > max_table_log)
+		throw RuntimeError("ANS table is not vaild.");
+
+	norms.assign(alphabet, 0);
+	uint64_t sum = 0;
+	for (size_t symbol = 0; symbol < alphabet;)
+	{
+		reader.refill();
+		const unsigned int length = reader.peek(5);
+		reader.consume(5);
+		if (length)
+		{
+			const unsigned int bits = length - 1;
+			norms[symbol] = (1u << bits) | (bits ? reader.peek(bits) : 0u);
+			reader.consume(bits);
+			sum += norms[symbol];
+			++symbol;
+			continue;
+		}
+
+		const size_t run = reader.peek(8) + 1;
+		reader.consume(8);
+		symbol += run;
+	}
+
+	// Frequencies have to fill whole table
+	if (sum != (uint64_t(1) << tableLog) || !reader.vaild())
+		throw RuntimeError("ANS table is not vaild.");
+
+	buildDecoding();
+}
+
+void ANS::encode(const std::vector<uint16_t> &symbols, BitWriter &writer) const
+{
+	// Bits written by every symbol (coded from the last one, so they are saved in reversed order)
+	std::vector<std::pair<uint16_t, uint8_t>> written(symbols.size());
+	uint32_t x = 1u << tableLog;
+	for (size_t i = symbols.size(); i-- > 0;)
+	{
+		const uint16_t symbol = symbols[i];
+		const uint8_t bits = static_cast<uint8_t>(x >= threshold[symbol] ? maxBits[symbol] : maxBits[symbol] - 1);
+		written[i] = std::make_pair(static_cast<uint16_t>(x & ((1u << bits) - 1)), bits);
+		x = states[start[symbol] + (x >> bits) - norms[symbol]];
+	}
+
+	// The last state is the first one of decoder
+	writer.put(x - (1u << tableLog), tableLog);
+	for (const auto &w : written)
+		writer.put(w.first, w.second);
+}
+
+void ANS::begin(BitReader &reader)
+{
+	reader.refill();
+	state = reader.peek(tableLog);
+	reader.consume(tableLog);
+}
+
+void ANS::encode(std::ofstream &ofile, const Image &image)
+{
+#ifdef _DEBUG
+	std::cout << "\n=== ANS COMPRESSION ===" << std::endl;
+#endif
+
+	const unsigned int width = image.width(),
+		height = image.height();
+
+	std::vector<uint16_t> pixels(static_cast<size_t>(width) * height);
+	for (unsigned int y = 0; y < height; ++y)
+	{
+		const uint16_t *row = reinterpret_cast<const uint16_t *>(image.row(y));
+		for (unsigned int x = 0; x < width; ++x)
+			pixels[static_cast<size_t>(y) * width + x] = row[x] & (Histogram::size - 1);
+	}
+
+	Histogram histogram(image);
+	std::vector<uint32_t> freqs(Histogram::size);
+	for (uint32_t color = 0; color < Histogram::size; ++color)
+		freqs[color] = histogram[color];
+	build(freqs);
+
+#ifdef _DEBUG
+	std::cout << "Colors: " << histogram.colors() << ", table: " << (1u << tableLog) << " states" << std::endl;
+#endif
+
+	BitWriter writer;
+	saveTable(writer);
+	encode(pixels, writer);
+	writer.write(ofile);
+
+#ifdef _DEBUG
+	std::cout << "=== ANS COMPRESSION DONE ===\n" << std::endl;
+#endif
+}
+
+void ANS::decode(std::ifstream &ifile, Image &image)
+{
+#ifdef _DEBUG
+	std::cout << "\n=== ANS DECOMPRESSION ===" << std::endl;
+#endif
+
+	if (alphabet != Histogram::size)
+		throw RuntimeError("ANS of pixels needs alphabet of all colors.");
+
+	// Codes are read in chunks (the next one in background)
+	ChunkReader chunks(ifile);
+	BitReader reader(chunks);
+	readTable(reader);
+	begin(reader);
+
+	const unsigned int width = image.width(),
+		height = image.height();
+	for (unsigned int y = 0; y < height; ++y)
+	{
+		uint16_t *row = reinterpret_cast<uint16_t *>(image.row(y));
+		for (unsigned int x = 0; x < width; ++x)
+			row[x] = next(reader);
+	}
+
+	if (!reader.vaild())
+		throw RuntimeError("Unexpected end of ANS data.");
+
+#ifdef _DEBUG
+	std::cout << "=== ANS DECOMPRESSION DONE ===\n" << std::endl;
+#endif
+}
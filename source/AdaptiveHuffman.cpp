@@ -0,0 +1,180 @@
+#include "AdaptiveHuffman.h"
+#include "BitStream.h"
+#include "ChunkReader.h"
+#include "RuntimeError.h"
+
+#include <iostream>
+#include <sstream>
+#include <algorithm> // min
+
+// Definitions of constants passed by reference (std::min)
+constexpr size_t AdaptiveHuffman::first_interval;
+constexpr size_t AdaptiveHuffman::max_interval;
+constexpr uint32_t AdaptiveHuffman::max_total;
+
+AdaptiveHuffman::AdaptiveHuffman(unsigned int maxLength)
+	: total(0), coded(0), interval(first_interval),
+	maxLength(maxLength ? std::min(maxLength, Huffman::max_length_limit) : Huffman::default_max_length),
+	lengthLimit(0)
+{}
+
+void AdaptiveHuffman::reset()
+{
+	freqs.fill(0);
+	freqs[escape] = 1;
+	total = 1;
+	coded = 0;
+	interval = first_interval;
+	rebuild();
+}
+
+void AdaptiveHuffman::update(uint32_t color, bool escaped)
+{
+	++freqs[color];
+	++total;
+	if (escaped)
+	{
+		++freqs[escape];
+		++total;
+	}
+
+	if (++coded == interval)
+	{
+		coded = 0;
+		interval = std::min(2 * interval, max_interval);
+		rebuild();
+	}
+}
+
+void AdaptiveHuffman::rebuild()
+{
+	// Old frequencies are halved (coded symbols keep at least 1, so they keep their codes)
+	if (total > max_total)
+	{
+		total = 0;
+		for (auto &freq : freqs)
+		{
+			freq = (freq + 1) / 2;
+			total += freq;
+		}
+	}
+
+	std::vector<std::pair<uint32_t, uint32_t>> symbolFreqs;
+	for (uint32_t symbol = 0; symbol < symbols; ++symbol)
+	{
+		if (freqs[symbol])
+			symbolFreqs.push_back(std::make_pair(symbol, freqs[symbol]));
+	}
+	std::vector<unsigned int> lengths = Huffman::limitedLengths(symbolFreqs, lengthLimit);
+
+	// Canonical codes, so they depend only on lengths
+	std::vector<uint8_t> symbolLengths(symbols, 0);
+	for (size_t i = 0; i < symbolFreqs.size(); ++i)
+		symbolLengths[symbolFreqs[i].first] = static_cast<uint8_t>(lengths[i]);
+
+	codes = Huffman::canonicalCodes(symbolLengths);
+	table = Huffman::lookupTable(codes, lengthLimit);
+}
+
+void AdaptiveHuffman::encode(std::ofstream &ofile, const Image &image)
+{
+#ifdef _DEBUG
+	std::cout << "\n=== ADAPTIVE HUFFMAN COMPRESSION ===" << std::endl;
+#endif
+
+	// Limit which is enough to give every color and escape its own code
+	lengthLimit = maxLength;
+	while ((size_t(1) << lengthLimit) < symbols)
+		++lengthLimit;
+	reset();
+
+	const uint8_t limit = static_cast<uint8_t>(lengthLimit);
+	ofile.write(reinterpret_cast<const char *>(&limit), sizeof(limit));
+
+	const unsigned int width = image.width(),
+		height = image.height();
+
+	// Every row is moved to file right after it is coded
+	BitWriter writer;
+	for (unsigned int y = 0; y < height; ++y)
+	{
+		const uint16_t *row = reinterpret_cast<const uint16_t *>(image.row(y));
+		for (unsigned int x = 0; x < width; ++x)
+		{
+			const uint32_t color = row[x] & (Histogram::size - 1);
+			const auto &code = codes[color];
+			const bool escaped = code.second == 0;
+			if (escaped)
+			{
+				writer.put(codes[escape].first, codes[escape].second);
+				writer.put(color, 12);
+			}
+			else
+				writer.put(code.first, code.second);
+
+			update(color, escaped);
+		}
+		writer.drain(ofile);
+	}
+	writer.write(ofile);
+
+#ifdef _DEBUG
+	std::cout << "=== ADAPTIVE HUFFMAN COMPRESSION DONE ===\n" << std::endl;
+#endif
+}
+
+void AdaptiveHuffman::decode(std::ifstream &ifile, Image &image)
+{
+#ifdef _DEBUG
+	std::cout << "\n=== ADAPTIVE HUFFMAN DECOMPRESSION ===" << std::endl;
+#endif
+
+	uint8_t limit = 0;
+	ifile.read(reinterpret_cast<char *>(&limit), sizeof(limit));
+	if (limit > Huffman::max_length_limit || (size_t(1) << limit) < symbols)
+	{
+		std::ostringstream os;
+		os << "Adaptive Huffman header is not vaild (length limit: " << static_cast<unsigned int>(limit) << ").";
+		throw RuntimeError(os.str());
+	}
+	lengthLimit = limit;
+	reset();
+
+	// Codes are read in chunks (the next one in background)
+	ChunkReader chunks(ifile);
+	BitReader reader(chunks);
+
+	const unsigned int width = image.width(),
+		height = image.height();
+	for (unsigned int y = 0; y < height; ++y)
+	{
+		uint16_t *row = reinterpret_cast<uint16_t *>(image.row(y));
+		for (unsigned int x = 0; x < width; ++x)
+		{
+			// Code and 12 bits of color after escape take at most 28 bits of refilled ones
+			reader.refill();
+			const auto entry = table[reader.peek(lengthLimit)];
+			if (entry.second == 0)
+				throw RuntimeError("Invaild adaptive Huffman code.");
+			reader.consume(entry.second);
+
+			uint32_t color = entry.first;
+			const bool escaped = color == escape;
+			if (escaped)
+			{
+				color = reader.peek(12);
+				reader.consume(12);
+			}
+
+			row[x] = static_cast<uint16_t>(color);
+			update(color, escaped);
+		}
+	}
+
+	if (!reader.vaild())
+		throw RuntimeError("Unexpected end of adaptive Huffman data.");
+
+#ifdef _DEBUG
+	std::cout << "=== ADAPTIVE HUFFMAN DECOMPRESSION DONE ===\n" << std::endl;
+#endif
+}
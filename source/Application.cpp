@@ -1,5 +1,9 @@
 ﻿#include "SDL_Local.h"
 #include "RGB12.h"
+#include "Huffman.h"
+#include "Dictionary.h"
+#include "SurfacePool.h"
+#include "Kernels.h"
 #include "BMP.h"
 #include "InputHandler.h"
 #include "CText.h"
@@ -10,6 +14,7 @@
 #include <tuple>
 #include <vector>
 #include <regex>
+#include <stdexcept>
 
 #ifdef _WIN32
 void normalizePathSeparator(std::string &path)
@@ -88,7 +93,22 @@ int main(int argc, char *argv[])
 
 			<< "\t(-s | --show)\t\t show output file afterwards" << std::endl
 			<< "\t(-gs | --grayscale)\t convert image to grayscale (even if it is already in grayscale!)" << std::endl
-			<< "\t(--huffman | --lz77)\t use different compression algorithm (default = BitDensity)\n" << std::endl;
+			<< "\t(--huffman | --lz77)\t use different compression algorithm (default = BitDensity)" << std::endl
+			<< "\t(--deflate)\t\t code sequences of pixels found by LZ77 with Huffman codes" << std::endl
+			<< "\t(--ans)\t\t\t code pixels with table based ANS (fractional bits per pixel)" << std::endl
+			<< "\t(--code-length bits)\t limit length of --huffman codes (default = " << Huffman::default_max_length << ", max = " << Huffman::max_length_limit << ", 0 = not limited)" << std::endl
+			<< "\t(--streams)\t\t split --huffman codes into " << Huffman::streams << " interleaved streams (faster decoding)" << std::endl
+			<< "\t(--adaptive)\t\t rebuild --huffman codes while coding (one pass, no saved frequencies)" << std::endl
+			<< "\t(--channels)\t\t code differences of every color component from its neighbour with --huffman (better for photos)" << std::endl
+			<< "\t(--train file)\t\t train dictionary from all input images and save it to file (nothing else is saved)" << std::endl
+			<< "\t(--dict file)\t\t use trained dictionary with --huffman | --lz77 (needed to load files saved with it too)" << std::endl
+			<< "\t(--huge-pages)\t\t place pixels of images bigger than " << (SurfacePool::default_huge_threshold >> 20) << " MB in huge pages (Linux only)" << std::endl
+			<< "\t(--cpu level)\t\t force kernels of instruction set: generic, sse4.2, avx2, avx512 (default = " << Kernels::name(Kernels::detected()) << ", also RGB12_CPU variable)" << std::endl
+			<< "\t(--planar)\t\t code red, then green and blue components of every row with --lz77" << std::endl
+			<< "\t(--best)\t\t try every --lz77 layout and keep the smaller one, search more --deflate sequences (slower encoding)" << std::endl
+			<< "\t(--ycocg)\t\t transform colors to luma and chroma before saving with any algorithm (reversible)" << std::endl
+			<< "\t(--palette)\t\t index colors of images with at most " << Palette::max_colors << " colors (--huffman | --lz77 saves indices)" << std::endl
+			<< "\t(--auto [budget])\t choose algorithm (and color transform) for every image separately, budget limits relative encoding cost (default = " << RGB12::default_budget << ")\n" << std::endl;
 			
 
 		return EXIT_SUCCESS;
@@ -165,6 +185,124 @@ int main(int argc, char *argv[])
 			alg = RGB12::Algorithm::Huffman;
 		else if (cli.isset("-lz77"))
 			alg = RGB12::Algorithm::LZ77;
+		else if (cli.isset("-deflate"))
+			alg = RGB12::Algorithm::Deflate;
+		else if (cli.isset("-ans"))
+			alg = RGB12::Algorithm::ANS;
+
+		// Limit length of Huffman codes if set
+		unsigned int codeLength = Huffman::default_max_length;
+		std::vector<std::string> codeLengthArguments = cli.get("-code-length");
+		if (!codeLengthArguments.empty())
+		{
+			try
+			{
+				unsigned long bits = std::stoul(codeLengthArguments[0]);
+				if (bits > Huffman::max_length_limit)
+					throw std::out_of_range("code length");
+				codeLength = static_cast<unsigned int>(bits);
+			}
+			catch (const std::exception &)
+			{
+				std::cerr << '[' << CText("Warning", CText::Color::YELLOW) << "]: Invaild code length: '" << codeLengthArguments[0]
+					<< "', using default: " << codeLength << std::endl;
+			}
+		}
+
+		// Code separated color planes with LZ77
+		LZ77::Layout layout = cli.isset("-planar") ? LZ77::Layout::Planar : LZ77::Layout::Interleaved;
+
+		// Try every LZ77 layout and keep the smaller one, search more sequences with Deflate (slower encoding)
+		LZ77::Level level = cli.isset("-best") ? LZ77::Level::Best : LZ77::Level::Fast;
+
+		// Index colors with palette (previously chosen algorithm saves indices)
+		Palette::Stage stage = Palette::Stage::Packed;
+		if (cli.isset("-palette"))
+		{
+			if (alg == RGB12::Algorithm::Huffman)
+				stage = Palette::Stage::Huffman;
+			else if (alg == RGB12::Algorithm::LZ77)
+				stage = Palette::Stage::LZ77;
+			alg = RGB12::Algorithm::Palette;
+		}
+
+		// Split Huffman codes into interleaved streams (faster decoding)
+		if (cli.isset("-streams") && alg == RGB12::Algorithm::Huffman)
+			alg = RGB12::Algorithm::InterleavedHuffman;
+
+		// Rebuild Huffman codes while coding (one pass over image)
+		if (cli.isset("-adaptive") && alg == RGB12::Algorithm::Huffman)
+			alg = RGB12::Algorithm::AdaptiveHuffman;
+
+		// Code every color component with its own tiny Huffman table
+		if (cli.isset("-channels") && alg == RGB12::Algorithm::Huffman)
+			alg = RGB12::Algorithm::ChannelHuffman;
+
+		// Choose algorithm automatically for every image if set
+		unsigned int budget = RGB12::default_budget;
+		std::vector<std::string> autoArguments = cli.get("-auto");
+		bool isAuto = cli.isset("-auto");
+		if (!autoArguments.empty())
+		{
+			try
+			{
+				budget = static_cast<unsigned int>(std::stoul(autoArguments[0]));
+			}
+			catch (const std::exception &)
+			{
+				std::cerr << '[' << CText("Warning", CText::Color::YELLOW) << "]: Invaild budget: '" << autoArguments[0]
+					<< "', using default: " << budget << std::endl;
+			}
+		}
+
+		// Train dictionary from all input images if set
+		std::vector<std::string> trainArguments = cli.get("-train");
+		bool isTraining = !trainArguments.empty();
+		Dictionary dictionary(codeLength);
+
+		// Load dictionary used by Huffman and LZ77 (saving and loading) if set
+		std::vector<std::string> dictionaryArguments = cli.get("-dict");
+		bool isDictionary = false;
+		if (!isTraining && !dictionaryArguments.empty())
+		{
+			try
+			{
+				dictionary.load(dictionaryArguments[0]);
+				isDictionary = true;
+			}
+			catch (const RuntimeError &error)
+			{
+				std::cerr << '[' << CText("Warning", CText::Color::YELLOW) << "]: Dictionary not loaded: " << error.what() << std::endl;
+			}
+		}
+
+		// Gray scale images which are only saved with Algorithm::GrayScale
+		// can be converted and saved at once (without any copy of them)
+		bool isGrayOnly = cli.isset({ "gs", "-grayscale" }) && alg == RGB12::Algorithm::BitDensity
+			&& !isAuto && isOutput && !isTraining && !cli.isset({ "s", "-show" });
+
+		// Reuse surfaces of released Images when processing more files
+		if (parsedFiles.size() > 1)
+			SurfacePool::shared().limit(SurfacePool::default_limit);
+
+		// Place pixels of very large Images in huge pages
+		if (cli.isset("-huge-pages"))
+			SurfacePool::shared().hugePages();
+
+		// Force kernels of given instruction set (benchmarking and testing)
+		std::vector<std::string> cpuArguments = cli.get("-cpu");
+		if (!cpuArguments.empty())
+		{
+			try
+			{
+				Kernels::force(Kernels::parse(cpuArguments[0]));
+			}
+			catch (const RuntimeError &error)
+			{
+				std::cerr << '[' << CText("Warning", CText::Color::YELLOW) << "]: " << error.what()
+					<< " Using: " << Kernels::name(Kernels::level()) << std::endl;
+			}
+		}
 
 		// Start processing files
 		size_t id = 0;
@@ -174,12 +312,27 @@ int main(int argc, char *argv[])
 			std::tie(fullpath, path, name, ext) = file;
 
 			RGB12 input;
+			if (isDictionary)
+				input.dictionary = &dictionary;
 
 			// Load input file proper way
 			if (ext == "bmp")
 			{
 				BMP bmp_input;
 				bmp_input.load(fullpath);
+
+				if (isGrayOnly && !bmp_input.image.empty())
+				{
+					std::string outputFile = proccessOutputPattern(outputPatterns[0], id, path, name, ext);
+					if (!std::regex_match(outputFile, save_bmp))
+					{
+						input.saveGrayScale(bmp_input.image, outputFile);
+						std::cout << outputFile << std::endl;
+						++id;
+						continue;
+					}
+				}
+
 				input = std::move(bmp_input);
 			}
 			else
@@ -191,11 +344,29 @@ int main(int argc, char *argv[])
 			if (!input.image.empty())
 			{
 				input.algorithm = alg;
+				input.paletteStage = stage;
+				input.lz77Layout = layout;
+				input.lz77Level = level;
+				input.huffmanLength = codeLength;
+				input.colorTransform = cli.isset("-ycocg");
+				if (isDictionary)
+					input.dictionary = &dictionary;
 
 				// Convert to gray scale if needed
 				if (cli.isset({ "gs", "-grayscale" }))
 					input.toGrayScale();
 
+				// Use image only as a sample of dictionary
+				if (isTraining)
+				{
+					dictionary.add(input.image);
+					++id;
+					continue;
+				}
+
+				if (isAuto)
+					input.autoAlgorithm(budget);
+
 				// Save with chosen algoirthm if any output set
 				if (isOutput)
 				{
@@ -222,6 +393,20 @@ int main(int argc, char *argv[])
 				++id;
 			}
 		}
+
+		// Save trained dictionary
+		if (isTraining)
+		{
+			try
+			{
+				dictionary.save(trainArguments[0]);
+				std::cout << trainArguments[0] << " (ID: " << dictionary.id() << ", samples: " << id << ')' << std::endl;
+			}
+			catch (const RuntimeError &error)
+			{
+				std::cerr << '[' << CText("Dictionary Error") << "]: " << error.what() << std::endl;
+			}
+		}
 	}
 	else
 	{
@@ -0,0 +1,56 @@
+#include "BitStream.h"
+
+#include <tuple> // tie
+
+void BitWriter::put(const std::vector<bool> &code)
+{
+	for (auto bit : code)
+		put(bit ? 1u : 0u, 1);
+}
+
+const std::vector<uint8_t>& BitWriter::flush()
+{
+	// Remaining bits are moved to buffer and the last byte is filled with 0
+	while (count >= 8)
+	{
+		count -= 8;
+		buffer.push_back(static_cast<uint8_t>(bits >> count));
+	}
+
+	if (count)
+	{
+		buffer.push_back(static_cast<uint8_t>(bits << (8 - count)));
+		count = 0;
+	}
+
+	return buffer;
+}
+
+void BitWriter::write(std::ofstream &file)
+{
+	flush();
+	drain(file);
+}
+
+void BitWriter::drain(std::ofstream &file)
+{
+	// Remarks: buffer has only whole words, bits not moved to it aren't part of any written byte
+	file.write(reinterpret_cast<const char *>(buffer.data()), buffer.size());
+	buffer.clear();
+}
+
+void BitReader::refillTail()
+{
+	while (count <= 56)
+	{
+		// Remarks: bits loaded in advance are only from current chunk, so next one can follow them
+		if (next == end && source != nullptr)
+			std::tie(next, end) = source->take();
+
+		if (next < end)
+			bits |= static_cast<uint64_t>(*next++) << (56 - count);
+		else
+			padding += 8;
+		count += 8;
+	}
+}
@@ -0,0 +1,226 @@
+#include "ChannelHuffman.h"
+#include "Huffman.h"
+#include "BitStream.h"
+#include "ChunkReader.h"
+#include "RuntimeError.h"
+
+#include <iostream>
+#include <cmath> // log2
+
+ChannelHuffman::ChannelHuffman()
+	: predictor(Predictor::None)
+{}
+
+uint16_t ChannelHuffman::residual(uint16_t pixel, uint16_t predicted)
+{
+	return static_cast<uint16_t>((((pixel >> 8) - (predicted >> 8)) & 0x0F) << 8
+		| (((pixel >> 4) - (predicted >> 4)) & 0x0F) << 4
+		| ((pixel - predicted) & 0x0F));
+}
+
+uint16_t ChannelHuffman::restore(uint16_t residual, uint16_t predicted)
+{
+	return static_cast<uint16_t>((((residual >> 8) + (predicted >> 8)) & 0x0F) << 8
+		| (((residual >> 4) + (predicted >> 4)) & 0x0F) << 4
+		| ((residual + predicted) & 0x0F));
+}
+
+ChannelHuffman::Counts ChannelHuffman::choosePredictor(const Image &image)
+{
+	const unsigned int width = image.width(),
+		height = image.height();
+
+	Predictor best = Predictor::None;
+	Counts bestCounts = {};
+	double fewest = 0.0;
+	for (auto candidate : { Predictor::None, Predictor::Left, Predictor::Up, Predictor::Average })
+	{
+		predictor = candidate;
+
+		Counts counts = {};
+		dispatch([&](auto p)
+		{
+			const uint16_t *above = nullptr;
+			for (unsigned int y = 0; y < height; ++y)
+			{
+				const uint16_t *row = reinterpret_cast<const uint16_t *>(image.row(y));
+				for (unsigned int x = 0; x < width; ++x)
+				{
+					const uint16_t r = residual(row[x] & 0x0FFF, predict<decltype(p)::value>(row, above, x) & 0x0FFF);
+					++counts[0][r >> 8];
+					++counts[1][(r >> 4) & 0x0F];
+					++counts[2][r & 0x0F];
+				}
+				above = row;
+			}
+		});
+
+		// Bits needed by ideal codes of all three components
+		const double total = static_cast<double>(width) * height;
+		double bits = 0.0;
+		for (const auto &channel : counts)
+			for (auto count : channel)
+				if (count)
+					bits += count * std::log2(total / count);
+
+		if (candidate == Predictor::None || bits < fewest)
+		{
+			fewest = bits;
+			best = candidate;
+			bestCounts = counts;
+		}
+	}
+
+	predictor = best;
+	return bestCounts;
+}
+
+void ChannelHuffman::buildLengths(const Counts &counts)
+{
+	for (unsigned int channel = 0; channel < 3; ++channel)
+	{
+		std::vector<std::pair<uint32_t, uint32_t>> freqs;
+		for (uint32_t symbol = 0; symbol < symbols; ++symbol)
+		{
+			if (counts[channel][symbol])
+				freqs.push_back(std::make_pair(symbol, counts[channel][symbol]));
+		}
+
+		const std::vector<unsigned int> limited = Huffman::limitedLengths(freqs, max_length);
+		lengths[channel].assign(symbols, 0);
+		for (size_t i = 0; i < freqs.size(); ++i)
+			lengths[channel][freqs[i].first] = static_cast<uint8_t>(limited[i]);
+	}
+}
+
+void ChannelHuffman::encode(std::ofstream &ofile, const Image &image)
+{
+#ifdef _DEBUG
+	std::cout << "\n=== CHANNEL HUFFMAN COMPRESSION ===" << std::endl;
+#endif
+
+	// Counts of chosen predictor's differences are used for codes (image is not counted again)
+	buildLengths(choosePredictor(image));
+
+#ifdef _DEBUG
+	std::cout << "Predictor: " << static_cast<unsigned int>(predictor) << std::endl;
+#endif
+
+	// Header - predictor and 4 bit lengths of all codes
+	BitWriter writer;
+	writer.put(static_cast<uint32_t>(predictor), 8);
+	for (const auto &channel : lengths)
+		for (auto length : channel)
+			writer.put(length, 4);
+
+	const std::array<std::vector<std::pair<uint32_t, uint8_t>>, 3> codes = {
+		Huffman::canonicalCodes(lengths[0]),
+		Huffman::canonicalCodes(lengths[1]),
+		Huffman::canonicalCodes(lengths[2]) };
+
+	const unsigned int width = image.width(),
+		height = image.height();
+	dispatch([&](auto p)
+	{
+		const uint16_t *above = nullptr;
+		for (unsigned int y = 0; y < height; ++y)
+		{
+			const uint16_t *row = reinterpret_cast<const uint16_t *>(image.row(y));
+			for (unsigned int x = 0; x < width; ++x)
+			{
+				const uint16_t r = residual(row[x] & 0x0FFF, predict<decltype(p)::value>(row, above, x) & 0x0FFF);
+				const auto &red = codes[0][r >> 8],
+					&green = codes[1][(r >> 4) & 0x0F],
+					&blue = codes[2][r & 0x0F];
+
+				// All three codes are put at once (at most 24 bits)
+				writer.put(red.first << (green.second + blue.second) | green.first << blue.second | blue.first,
+					red.second + green.second + blue.second);
+			}
+			above = row;
+		}
+	});
+
+	writer.write(ofile);
+
+#ifdef _DEBUG
+	std::cout << "=== CHANNEL HUFFMAN COMPRESSION DONE ===\n" << std::endl;
+#endif
+}
+
+void ChannelHuffman::decode(std::ifstream &ifile, Image &image)
+{
+#ifdef _DEBUG
+	std::cout << "\n=== CHANNEL HUFFMAN DECOMPRESSION ===" << std::endl;
+#endif
+
+	// Codes are read in chunks (the next one in background)
+	ChunkReader chunks(ifile);
+	BitReader reader(chunks);
+
+	reader.refill();
+	const uint32_t saved = reader.peek(8);
+	reader.consume(8);
+	if (saved > static_cast<uint32_t>(Predictor::Average))
+		throw RuntimeError("Saved with unknown channel Huffman predictor.");
+	predictor = static_cast<Predictor>(saved);
+
+	// Codes have to fit into max_length bits (otherwise they would overlap)
+	for (auto &channel : lengths)
+	{
+		uint32_t used = 0;
+		channel.assign(symbols, 0);
+		for (auto &length : channel)
+		{
+			reader.refill();
+			length = static_cast<uint8_t>(reader.peek(4));
+			reader.consume(4);
+			if (length > max_length)
+				throw RuntimeError("Channel Huffman header is not vaild.");
+			if (length)
+				used += 1u << (max_length - length);
+		}
+		if (used > (1u << max_length))
+			throw RuntimeError("Channel Huffman header is not vaild.");
+	}
+
+	const std::array<std::vector<std::pair<uint16_t, uint8_t>>, 3> tables = {
+		Huffman::lookupTable(Huffman::canonicalCodes(lengths[0]), max_length),
+		Huffman::lookupTable(Huffman::canonicalCodes(lengths[1]), max_length),
+		Huffman::lookupTable(Huffman::canonicalCodes(lengths[2]), max_length) };
+
+	const unsigned int width = image.width(),
+		height = image.height();
+	dispatch([&](auto p)
+	{
+		const uint16_t *above = nullptr;
+		for (unsigned int y = 0; y < height; ++y)
+		{
+			uint16_t *row = reinterpret_cast<uint16_t *>(image.row(y));
+			for (unsigned int x = 0; x < width; ++x)
+			{
+				// Codes of all three components take at most 24 of refilled bits
+				reader.refill();
+				const auto &red = tables[0][reader.peek(max_length)];
+				reader.consume(red.second);
+				const auto &green = tables[1][reader.peek(max_length)];
+				reader.consume(green.second);
+				const auto &blue = tables[2][reader.peek(max_length)];
+				reader.consume(blue.second);
+
+				if (!red.second || !green.second || !blue.second)
+					throw RuntimeError("Invaild channel Huffman code.");
+
+				row[x] = restore(static_cast<uint16_t>(red.first << 8 | green.first << 4 | blue.first), predict<decltype(p)::value>(row, above, x));
+			}
+			above = row;
+		}
+	});
+
+	if (!reader.vaild())
+		throw RuntimeError("Unexpected end of channel Huffman data.");
+
+#ifdef _DEBUG
+	std::cout << "=== CHANNEL HUFFMAN DECOMPRESSION DONE ===\n" << std::endl;
+#endif
+}
@@ -0,0 +1,122 @@
+#include "ChunkReader.h"
+
+#include <algorithm> // min
+#include <cstring>   // memcpy
+
+ChunkReader::ChunkReader(std::ifstream &file, size_t chunkSize)
+	: file(file), chunkSize(chunkSize ? chunkSize : default_chunk_size),
+	ready(false), stopping(false), finished(false),
+	position(nullptr), last(nullptr)
+{
+	reader = std::thread(&ChunkReader::work, this);
+}
+
+ChunkReader::~ChunkReader()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	condition.notify_all();
+	reader.join();
+}
+
+void ChunkReader::work()
+{
+	try
+	{
+		bool full = true;
+		while (full)
+		{
+			// Waits until the previous chunk is taken
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				condition.wait(lock, [this] { return stopping || !ready; });
+				if (stopping)
+					return;
+			}
+
+			prefetched.resize(chunkSize);
+			file.read(reinterpret_cast<char *>(prefetched.data()), static_cast<std::streamsize>(chunkSize));
+			prefetched.resize(static_cast<size_t>(file.gcount()));
+
+			// The last chunk is not full, so nothing follows it
+			full = prefetched.size() == chunkSize;
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				ready = true;
+			}
+			condition.notify_all();
+		}
+	}
+	catch (...)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			error = std::current_exception();
+			ready = true;
+		}
+		condition.notify_all();
+	}
+}
+
+bool ChunkReader::next()
+{
+	if (finished)
+		return false;
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		condition.wait(lock, [this] { return ready; });
+
+		// Rethrows exception of reading (if any)
+		if (error)
+		{
+			finished = true;
+			position = last = nullptr;
+			std::rethrow_exception(error);
+		}
+
+		current.swap(prefetched);
+		ready = false;
+	}
+	condition.notify_all();
+
+	finished = current.size() != chunkSize;
+	if (current.empty())
+	{
+		position = last = nullptr;
+		return false;
+	}
+
+	position = current.data();
+	last = position + current.size();
+	return true;
+}
+
+size_t ChunkReader::read(uint8_t *bytes, size_t length)
+{
+	size_t done = 0;
+	while (done < length)
+	{
+		if (position == last && !next())
+			break;
+
+		const size_t count = std::min(length - done, static_cast<size_t>(last - position));
+		std::memcpy(bytes + done, position, count);
+		position += count;
+		done += count;
+	}
+	return done;
+}
+
+std::pair<const uint8_t *, const uint8_t *> ChunkReader::take()
+{
+	if (position == last && !next())
+		return std::make_pair(nullptr, nullptr);
+
+	auto range = std::make_pair(position, last);
+	position = last;
+	return range;
+}
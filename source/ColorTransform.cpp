@@ -0,0 +1,94 @@
+#include "ColorTransform.h"
+#include "ThreadPool.h"
+#include "RGB12.h"
+
+unsigned int ColorTransform::half(unsigned int component)
+{
+	// Shift of 4 bit value which keeps its sign bit (no shift of negative int, so it is the same with every compiler)
+	return ((component & 0x0F) >> 1) | (component & 0x08);
+}
+
+uint16_t ColorTransform::forward(uint16_t rgb)
+{
+	const unsigned int r = (rgb >> 8) & 0x0F,
+		g = (rgb >> 4) & 0x0F,
+		b = rgb & 0x0F;
+
+	// Every step adds value computed from the others, so it is reversible even with wrapping
+	const unsigned int co = (r - b) & 0x0F,
+		t = (b + half(co)) & 0x0F,
+		cg = (g - t) & 0x0F,
+		y = (t + half(cg)) & 0x0F;
+
+	return static_cast<uint16_t>(y << 8 | cg << 4 | co);
+}
+
+uint16_t ColorTransform::inverse(uint16_t transformed)
+{
+	const unsigned int y = (transformed >> 8) & 0x0F,
+		cg = (transformed >> 4) & 0x0F,
+		co = transformed & 0x0F;
+
+	// The same steps in reversed order
+	const unsigned int t = (y - half(cg)) & 0x0F,
+		g = (cg + t) & 0x0F,
+		b = (t - half(co)) & 0x0F,
+		r = (b + co) & 0x0F;
+
+	return static_cast<uint16_t>(r << 8 | g << 4 | b);
+}
+
+const std::array<uint16_t, Histogram::size>& ColorTransform::forwardTable()
+{
+	static const std::array<uint16_t, Histogram::size> table = []()
+	{
+		std::array<uint16_t, Histogram::size> values;
+		for (uint32_t color = 0; color < Histogram::size; ++color)
+			values[color] = forward(static_cast<uint16_t>(color));
+		return values;
+	}();
+
+	return table;
+}
+
+const std::array<uint16_t, Histogram::size>& ColorTransform::inverseTable()
+{
+	static const std::array<uint16_t, Histogram::size> table = []()
+	{
+		std::array<uint16_t, Histogram::size> values;
+		for (uint32_t color = 0; color < Histogram::size; ++color)
+			values[color] = inverse(static_cast<uint16_t>(color));
+		return values;
+	}();
+
+	return table;
+}
+
+void ColorTransform::map(Image &image, const std::array<uint16_t, Histogram::size> &table)
+{
+	const unsigned int width = image.width();
+
+	// Pixels shared with other Image are copied once, before rows are modified in parallel
+	image.detach();
+
+	ThreadPool::shared().parallelFor(0, image.height(), RGB12::rows_per_chunk, [&](unsigned int, size_t first, size_t last)
+	{
+		uint16_t *row;
+		for (size_t y = first; y < last; ++y)
+		{
+			row = reinterpret_cast<uint16_t *>(image.row(static_cast<unsigned int>(y)));
+			for (unsigned int x = 0; x < width; ++x)
+				row[x] = table[row[x] & (Histogram::size - 1)];
+		}
+	});
+}
+
+void ColorTransform::apply(Image &image)
+{
+	map(image, forwardTable());
+}
+
+void ColorTransform::revert(Image &image)
+{
+	map(image, inverseTable());
+}
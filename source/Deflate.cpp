@@ -0,0 +1,345 @@
+#include "Deflate.h"
+#include "Huffman.h"
+#include "ChunkReader.h"
+#include "RuntimeError.h"
+
+#include <iostream>
+#include <sstream>
+#include <algorithm> // min, copy
+
+// Definitions of constants passed by reference (std::min)
+constexpr unsigned int Deflate::max_sequence;
+
+Deflate::Deflate(LZ77::Level level)
+	: level(level)
+{}
+
+std::pair<unsigned int, unsigned int> Deflate::valueCode(uint32_t value)
+{
+	if (value < 4)
+		return std::make_pair(value, 0u);
+
+	unsigned int highest = 2;
+	while (value >> (highest + 1))
+		++highest;
+	return std::make_pair(2 * highest + ((value >> (highest - 1)) & 1), highest - 1);
+}
+
+uint32_t Deflate::codeBase(unsigned int code)
+{
+	if (code < 4)
+		return code;
+	return static_cast<uint32_t>(2 | (code & 1)) << (code / 2 - 1);
+}
+
+unsigned int Deflate::extraBits(unsigned int code)
+{
+	return code < 4 ? 0 : code / 2 - 1;
+}
+
+std::vector<Deflate::Token> Deflate::tokenize(const std::vector<uint16_t> &pixels, unsigned int width) const
+{
+	const size_t n = pixels.size();
+	const uint32_t none = UINT32_MAX;
+	const unsigned int chain = (level == LZ77::Level::Best) ? 256u : 16u;
+
+	// The last position of every hash and previous position with the same hash
+	std::vector<uint32_t> head(size_t(1) << hash_bits, none),
+		previous(n, none);
+
+	auto hash = [&pixels](size_t i) -> uint32_t
+	{
+		const uint64_t key = uint64_t(pixels[i]) | uint64_t(pixels[i + 1]) << 12 | uint64_t(pixels[i + 2]) << 24;
+		return static_cast<uint32_t>((key * 0x9E3779B97F4A7C15ull) >> (64 - hash_bits));
+	};
+
+	auto insert = [&](size_t i)
+	{
+		if (i + min_sequence <= n)
+		{
+			const uint32_t h = hash(i);
+			previous[i] = head[h];
+			head[h] = static_cast<uint32_t>(i);
+		}
+	};
+
+	std::vector<Token> tokens;
+	size_t position = 0;
+	while (position < n)
+	{
+		const size_t longest = std::min(static_cast<size_t>(max_sequence), n - position);
+		size_t length = 0, distance = 0;
+
+		auto tryDistance = [&](size_t d)
+		{
+			const uint16_t *from = &pixels[position - d], *to = &pixels[position];
+			size_t count = 0;
+			while (count < longest && from[count] == to[count])
+				++count;
+			if (count > length)
+			{
+				length = count;
+				distance = d;
+			}
+		};
+
+		if (longest >= min_sequence)
+		{
+			// The previous pixel and the pixel above begin most of sequences, so they are tried first
+			if (position >= 1)
+				tryDistance(1);
+			if (width > 1 && width <= max_distance && position >= width && length < longest)
+				tryDistance(width);
+
+			uint32_t candidate = head[hash(position)];
+			for (unsigned int k = 0; k < chain && candidate != none && length < longest; ++k, candidate = previous[candidate])
+			{
+				const size_t d = position - candidate;
+				if (d > max_distance)
+					break;
+				if (d != 1 && d != width)
+					tryDistance(d);
+			}
+		}
+
+		if (length >= min_sequence)
+		{
+			tokens.push_back({ static_cast<uint32_t>(length), static_cast<uint32_t>(distance) });
+			for (size_t i = 0; i < length; ++i)
+				insert(position + i);
+			position += length;
+		}
+		else
+		{
+			tokens.push_back({ 0u, pixels[position] });
+			insert(position);
+			++position;
+		}
+	}
+
+	return tokens;
+}
+
+std::vector<uint8_t> Deflate::codeLengths(const std::vector<uint32_t> &freqs)
+{
+	std::vector<std::pair<uint32_t, uint32_t>> symbolFreqs;
+	for (uint32_t symbol = 0; symbol < freqs.size(); ++symbol)
+	{
+		if (freqs[symbol])
+			symbolFreqs.push_back(std::make_pair(symbol, freqs[symbol]));
+	}
+
+	std::vector<uint8_t> lengths(freqs.size(), 0);
+	std::vector<unsigned int> limited = Huffman::limitedLengths(symbolFreqs, max_length);
+	for (size_t i = 0; i < symbolFreqs.size(); ++i)
+		lengths[symbolFreqs[i].first] = static_cast<uint8_t>(limited[i]);
+	return lengths;
+}
+
+void Deflate::saveLengths(BitWriter &writer, const std::vector<uint8_t> &lengths)
+{
+	for (size_t i = 0; i < lengths.size();)
+	{
+		if (lengths[i])
+		{
+			writer.put(lengths[i], 4);
+			++i;
+			continue;
+		}
+
+		// Run of symbols without code (at most 256)
+		size_t run = 1;
+		while (i + run < lengths.size() && run < 256 && lengths[i + run] == 0)
+			++run;
+		writer.put(0, 4);
+		writer.put(static_cast<uint32_t>(run - 1), 8);
+		i += run;
+	}
+}
+
+void Deflate::readLengths(BitReader &reader, std::vector<uint8_t> &lengths)
+{
+	// Codes have to fit into max_length bits (otherwise they would overlap)
+	uint64_t used = 0;
+	for (size_t i = 0; i < lengths.size();)
+	{
+		reader.refill();
+		const uint8_t length = static_cast<uint8_t>(reader.peek(4));
+		reader.consume(4);
+		if (length)
+		{
+			lengths[i++] = length;
+			used += uint64_t(1) << (max_length - length);
+			continue;
+		}
+
+		const size_t run = reader.peek(8) + 1;
+		reader.consume(8);
+		if (i + run > lengths.size())
+			throw RuntimeError("Deflate header is not vaild.");
+		std::fill(lengths.begin() + i, lengths.begin() + i + run, uint8_t(0));
+		i += run;
+	}
+
+	if (used > (uint64_t(1) << max_length) || !reader.vaild())
+		throw RuntimeError("Deflate header is not vaild.");
+}
+
+void Deflate::encode(std::ofstream &ofile, const Image &image)
+{
+#ifdef _DEBUG
+	std::cout << "\n=== DEFLATE COMPRESSION ===" << std::endl;
+#endif
+
+	const unsigned int width = image.width(),
+		height = image.height();
+
+	// Positions of pixels in hash chains are 32 bit (the highest one means none)
+	if (static_cast<uint64_t>(width) * height >= UINT32_MAX)
+	{
+		std::ostringstream os;
+		os << "Deflate cannot code more than " << (UINT32_MAX - 1) << " pixels (" << width << "x" << height << ").";
+		throw RuntimeError(os.str());
+	}
+
+	std::vector<uint16_t> pixels(static_cast<size_t>(width) * height);
+	for (unsigned int y = 0; y < height; ++y)
+	{
+		const uint16_t *row = reinterpret_cast<const uint16_t *>(image.row(y));
+		for (unsigned int x = 0; x < width; ++x)
+			pixels[static_cast<size_t>(y) * width + x] = row[x] & (Histogram::size - 1);
+	}
+
+	std::vector<Token> tokens = tokenize(pixels, width);
+
+	// Colors and codes of lengths share one alphabet
+	std::vector<uint32_t> literalFreqs(Histogram::size + length_codes, 0),
+		distanceFreqs(distance_codes, 0);
+	for (const auto &token : tokens)
+	{
+		if (token.length == 0)
+			++literalFreqs[token.value];
+		else
+		{
+			++literalFreqs[Histogram::size + valueCode(token.length - min_sequence).first];
+			++distanceFreqs[valueCode(token.value - 1).first];
+		}
+	}
+
+	const std::vector<uint8_t> literalLengths = codeLengths(literalFreqs),
+		distanceLengths = codeLengths(distanceFreqs);
+	const auto literalCodes = Huffman::canonicalCodes(literalLengths),
+		distanceCodes = Huffman::canonicalCodes(distanceLengths);
+
+#ifdef _DEBUG
+	std::cout << "Tokens: " << tokens.size() << " (pixels: " << pixels.size() << ")" << std::endl;
+#endif
+
+	BitWriter writer;
+	saveLengths(writer, literalLengths);
+	saveLengths(writer, distanceLengths);
+
+	for (const auto &token : tokens)
+	{
+		if (token.length == 0)
+		{
+			writer.put(literalCodes[token.value].first, literalCodes[token.value].second);
+			continue;
+		}
+
+		const auto length = valueCode(token.length - min_sequence),
+			distance = valueCode(token.value - 1);
+		const auto &lengthCode = literalCodes[Histogram::size + length.first],
+			&distanceCode = distanceCodes[distance.first];
+
+		writer.put(lengthCode.first, lengthCode.second);
+		if (length.second)
+			writer.put(token.length - min_sequence, length.second);
+		writer.put(distanceCode.first, distanceCode.second);
+		if (distance.second)
+			writer.put(token.value - 1, distance.second);
+	}
+
+	writer.write(ofile);
+
+#ifdef _DEBUG
+	std::cout << "=== DEFLATE COMPRESSION DONE ===\n" << std::endl;
+#endif
+}
+
+void Deflate::decode(std::ifstream &ifile, Image &image)
+{
+#ifdef _DEBUG
+	std::cout << "\n=== DEFLATE DECOMPRESSION ===" << std::endl;
+#endif
+
+	// Codes are read in chunks (the next one in background)
+	ChunkReader chunks(ifile);
+	BitReader reader(chunks);
+
+	std::vector<uint8_t> literalLengths(Histogram::size + length_codes, 0),
+		distanceLengths(distance_codes, 0);
+	readLengths(reader, literalLengths);
+	readLengths(reader, distanceLengths);
+
+	const auto literalTable = Huffman::lookupTable(Huffman::canonicalCodes(literalLengths), max_length),
+		distanceTable = Huffman::lookupTable(Huffman::canonicalCodes(distanceLengths), max_length);
+
+	const unsigned int width = image.width(),
+		height = image.height();
+	const size_t n = static_cast<size_t>(width) * height;
+	std::vector<uint16_t> pixels(n);
+
+	size_t position = 0;
+	while (position < n)
+	{
+		// Code of length with its extra bits and code of distance with its extra bits
+		// take at most 29 and 33 bits, so refill before each of them is enough
+		reader.refill();
+		const auto &literal = literalTable[reader.peek(max_length)];
+		if (literal.second == 0)
+			throw RuntimeError("Invaild Deflate code.");
+		reader.consume(literal.second);
+
+		if (literal.first < Histogram::size)
+		{
+			pixels[position++] = literal.first;
+			continue;
+		}
+
+		const unsigned int lengthCode = literal.first - Histogram::size;
+		unsigned int extra = extraBits(lengthCode);
+		size_t length = min_sequence + codeBase(lengthCode) + (extra ? reader.peek(extra) : 0);
+		reader.consume(extra);
+
+		reader.refill();
+		const auto &distanceCode = distanceTable[reader.peek(max_length)];
+		if (distanceCode.second == 0)
+			throw RuntimeError("Invaild Deflate code.");
+		reader.consume(distanceCode.second);
+		extra = extraBits(distanceCode.first);
+		const size_t distance = 1 + codeBase(distanceCode.first) + (extra ? reader.peek(extra) : 0);
+		reader.consume(extra);
+
+		if (distance > position || length > n - position)
+			throw RuntimeError("Invaild Deflate sequence.");
+
+		// Sequence can overlap itself (e.g. run of the same pixel with distance 1)
+		uint16_t *to = &pixels[position];
+		const uint16_t *from = to - distance;
+		for (size_t i = 0; i < length; ++i)
+			to[i] = from[i];
+		position += length;
+	}
+
+	if (!reader.vaild())
+		throw RuntimeError("Unexpected end of Deflate data.");
+
+	for (unsigned int y = 0; y < height; ++y)
+		std::copy(pixels.begin() + static_cast<size_t>(y) * width, pixels.begin() + static_cast<size_t>(y + 1) * width,
+			reinterpret_cast<uint16_t *>(image.row(y)));
+
+#ifdef _DEBUG
+	std::cout << "=== DEFLATE DECOMPRESSION DONE ===\n" << std::endl;
+#endif
+}
@@ -0,0 +1,154 @@
+#include "Dictionary.h"
+#include "RuntimeError.h"
+
+#include <fstream>
+#include <sstream>
+#include <algorithm> // max_element
+
+#ifdef _DEBUG
+#include <iostream>
+#endif
+
+Dictionary::Dictionary(unsigned int codeLength)
+	: identifier(0), color(0), codeLength(codeLength)
+{
+	counts.fill(0);
+	frequencies.fill(1);
+}
+
+std::string Dictionary::extension() const
+{
+	return std::string(".rgb12dict");
+}
+
+void Dictionary::add(const Image &image)
+{
+	Histogram histogram(image);
+	for (uint32_t c = 0; c < Histogram::size; ++c)
+		counts[c] += histogram[c];
+}
+
+void Dictionary::finish()
+{
+	// Scale counts down, so frequencies of all colors can't overflow while building codes
+	uint64_t most = *std::max_element(counts.begin(), counts.end());
+	unsigned int shift = 0;
+	while ((most >> shift) >= (1u << 20))
+		++shift;
+
+	for (size_t c = 0; c < Histogram::size; ++c)
+		frequencies[c] = static_cast<uint32_t>(counts[c] >> shift) + 1;
+
+	color = static_cast<uint16_t>(std::max_element(frequencies.begin(), frequencies.end()) - frequencies.begin());
+
+	// FNV-1a hash of everything used by codecs
+	identifier = 2166136261u;
+	auto hash = [this](uint32_t value)
+	{
+		for (int i = 0; i < 4; ++i, value >>= 8)
+		{
+			identifier ^= value & 0xFF;
+			identifier *= 16777619u;
+		}
+	};
+	hash(codeLength);
+	hash(color);
+	for (auto f : frequencies)
+		hash(f);
+}
+
+void Dictionary::save(const std::string &filename)
+{
+	finish();
+
+	std::ofstream output(filename, std::ios::out | std::ios::binary);
+	if (!output)
+	{
+		std::ostringstream os;
+		os << "Cannot open file: '" << filename << "' with write access.";
+		throw RuntimeError(os.str());
+	}
+
+	std::string ext = extension();
+	size_t ext_size = ext.size();
+	uint32_t length = codeLength;
+
+	output.write(reinterpret_cast<const char *>(&ext_size), sizeof(ext_size));
+	output.write(ext.c_str(), ext_size);
+	output.write(reinterpret_cast<const char *>(&identifier), sizeof(identifier));
+	output.write(reinterpret_cast<const char *>(&length), sizeof(length));
+	output.write(reinterpret_cast<const char *>(&color), sizeof(color));
+	output.write(reinterpret_cast<const char *>(frequencies.data()), sizeof(frequencies));
+
+#ifdef _DEBUG
+	std::cout << " -> [Dictionary::save]: Saved dictionary with ID: " << identifier << std::endl;
+#endif
+}
+
+void Dictionary::load(const std::string &filename)
+{
+	std::ifstream input(filename, std::ios::in | std::ios::binary);
+	if (!input)
+	{
+		std::ostringstream os;
+		os << "Cannot open file: '" << filename << "' with read access.";
+		throw RuntimeError(os.str());
+	}
+
+	// Verify header
+	std::string ext = extension();
+	size_t ext_size = 0;
+	input.read(reinterpret_cast<char *>(&ext_size), sizeof(ext_size));
+	if (ext_size != ext.size())
+		throw RuntimeError("Header of dictionary file is not vaild.");
+
+	std::string saved(ext_size, '\0');
+	input.read(&saved[0], ext_size);
+	if (saved != ext)
+		throw RuntimeError("Header of dictionary file is not vaild.");
+
+	uint32_t length, saved_id = 0;
+	input.read(reinterpret_cast<char *>(&saved_id), sizeof(saved_id));
+	input.read(reinterpret_cast<char *>(&length), sizeof(length));
+	input.read(reinterpret_cast<char *>(&color), sizeof(color));
+	input.read(reinterpret_cast<char *>(frequencies.data()), sizeof(frequencies));
+	if (!input)
+		throw RuntimeError("Unexpected end of dictionary file.");
+
+	codeLength = length;
+	for (size_t c = 0; c < Histogram::size; ++c)
+		counts[c] = frequencies[c] - 1;
+
+	// Check content using its hash
+	finish();
+	if (identifier != saved_id)
+		throw RuntimeError("Dictionary file is damaged (ID doesn't match its content).");
+
+#ifdef _DEBUG
+	std::cout << " -> [Dictionary::load]: Loaded dictionary with ID: " << identifier << std::endl;
+#endif
+}
+
+uint32_t Dictionary::id() const
+{
+	return identifier;
+}
+
+std::vector<std::pair<uint32_t, uint32_t>> Dictionary::colorFreqs() const
+{
+	std::vector<std::pair<uint32_t, uint32_t>> freqs;
+	freqs.reserve(Histogram::size);
+	for (uint32_t c = 0; c < Histogram::size; ++c)
+		freqs.push_back(std::make_pair(c, frequencies[c]));
+	return freqs;
+}
+
+uint16_t Dictionary::commonColor() const
+{
+	return color;
+}
+
+unsigned int Dictionary::huffmanLength() const
+{
+	return codeLength;
+}
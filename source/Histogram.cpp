@@ -0,0 +1,79 @@
+#include "Histogram.h"
+#include "ThreadPool.h"
+
+#include <cmath>
+#include <vector>
+
+Histogram::Histogram()
+	: pixels(0)
+{
+	counts.fill(0);
+}
+
+Histogram::Histogram(const Image &image, size_t rowStep)
+	: Histogram()
+{
+	if (image.empty())
+		return;
+
+	const unsigned int width = image.width();
+	const size_t rows = (image.height() + rowStep - 1) / rowStep;
+
+	// Every thread counts its rows to own counters, which are summed at the end
+	ThreadPool &pool = ThreadPool::shared();
+	std::vector<std::array<uint32_t, size>> partial(pool.threads(), std::array<uint32_t, size>{});
+
+	pool.parallelFor(0, rows, rows_per_chunk, [&](unsigned int chunk, size_t first, size_t last)
+	{
+		auto &chunkCounts = partial[chunk];
+		for (size_t row = first; row < last; ++row)
+		{
+			auto pixel = image.at(0, row * rowStep);
+			for (unsigned int x = 0; x < width; ++x, ++pixel)
+				++chunkCounts[pixel.value2() & (size - 1)];
+		}
+	});
+
+	for (auto &chunkCounts : partial)
+		for (size_t color = 0; color < size; ++color)
+			counts[color] += chunkCounts[color];
+
+	pixels = rows * width;
+}
+
+uint32_t Histogram::operator[](uint32_t color) const
+{
+	return counts[color & (size - 1)];
+}
+
+size_t Histogram::total() const
+{
+	return pixels;
+}
+
+size_t Histogram::colors() const
+{
+	size_t n = 0;
+	for (auto c : counts)
+		if (c)
+			++n;
+	return n;
+}
+
+double Histogram::entropy() const
+{
+	if (pixels == 0)
+		return 0.0;
+
+	double bits = 0.0;
+	const double all = static_cast<double>(pixels);
+	for (auto c : counts)
+	{
+		if (c)
+		{
+			double p = c / all;
+			bits -= p * std::log2(p);
+		}
+	}
+	return bits;
+}
@@ -1,15 +1,32 @@
 #include "Huffman.h"
-#include "BitsToFile.h"
+#include "BitStream.h"
+#include "Histogram.h"
+#include "RuntimeError.h"
 
 #include <iostream>
 #include <iomanip> // printCodes
+#include <sstream>
 #include <queue>
-#include <algorithm> // sort
+#include <array>
+#include <algorithm> // sort, stable_sort, min, max
 
-Huffman::Huffman()
+// Definitions of constants passed by reference (std::min)
+constexpr unsigned int Huffman::default_max_length;
+constexpr unsigned int Huffman::max_length_limit;
+constexpr unsigned int Huffman::streams;
+constexpr unsigned int Huffman::stream_block;
+
+Huffman::Huffman(unsigned int maxLength, bool interleaved, const Dictionary *dictionary)
 	:	codeVec(std::vector<std::pair<uint32_t, std::vector<bool>>>()),
-		colorFreqs(std::vector<std::pair<uint32_t, uint32_t>>())
-{}
+		colorFreqs(std::vector<std::pair<uint32_t, uint32_t>>()),
+		maxLength(std::min(maxLength, max_length_limit)),
+		lengthLimit(0),
+		interleaved(interleaved),
+		dictionary(dictionary)
+{
+	if (interleaved && this->maxLength == 0)
+		this->maxLength = default_max_length;
+}
 
 void Huffman::encode(std::ofstream &ofile, const Image &image)
 {
@@ -18,12 +35,30 @@ void Huffman::encode(std::ofstream &ofile, const Image &image)
 #endif
 
 	// Huffman algorithm
-	countFreq(image); // colorFreqs
+	if (dictionary)
+		useDictionary(); // colorFreqs
+	else
+	{
+		countFreq(image); // colorFreqs
+
+		// Limit which is enough to give every color its own code
+		lengthLimit = 0;
+		if (maxLength)
+		{
+			lengthLimit = maxLength;
+			while ((size_t(1) << lengthLimit) < colorFreqs.size())
+				++lengthLimit;
+		}
+	}
 	buildTree(); //codeVec
 
-	// Save compressed data to file
-	saveHuffHeader(ofile);
-	saveCodes(ofile, image);
+	// Save compressed data to file (frequencies from dictionary are not needed)
+	if (!dictionary)
+		saveHuffHeader(ofile);
+	if (interleaved)
+		saveStreams(ofile, image);
+	else
+		saveCodes(ofile, image);
 
 	// Clear generated data
 	clear();
@@ -40,10 +75,17 @@ void Huffman::decode(std::ifstream &ifile, Image &image)
 #endif
 
 	// Generate data
-	readHuffHeader(ifile); // read colorFreqs
+	if (dictionary)
+		useDictionary();
+	else
+		readHuffHeader(ifile); // read colorFreqs
 	buildTree(); //create codeVec
 
-	readCodes(ifile, image); // read data
+	// read data
+	if (interleaved)
+		readStreams(ifile, image);
+	else
+		readCodes(ifile, image);
 
 	// Clear generated data
 	clear();
@@ -53,6 +95,16 @@ void Huffman::decode(std::ifstream &ifile, Image &image)
 #endif
 }
 
+void Huffman::useDictionary()
+{
+	colorFreqs = dictionary->colorFreqs();
+
+	// Codes are always limited (so both sides get the same ones)
+	lengthLimit = dictionary->huffmanLength() ? std::min(dictionary->huffmanLength(), max_length_limit) : default_max_length;
+	while ((size_t(1) << lengthLimit) < colorFreqs.size())
+		++lengthLimit;
+}
+
 void Huffman::clear()
 {
 	codeVec.clear();
@@ -65,27 +117,11 @@ void Huffman::countFreq(const Image& image)
 	std::cout << "Counting colors..." << std::endl;
 #endif
 
-	bool found;
-	uint32_t color;
-	auto img_end = image.end();
-
-	for (auto pixel_it = image.begin(); pixel_it < img_end; ++pixel_it)
+	Histogram histogram(image);
+	for (uint32_t color = 0; color < Histogram::size; ++color)
 	{
-		found = false;
-		color = pixel_it.value2();
-
-		for (auto &v : colorFreqs) // check if already appeared
-		{
-			if (v.first == color) // if found - increment frequency
-			{
-				++v.second;
-				found = true;
-				break;
-			}
-		}
-
-		if (!found) // if not found - Add it
-			colorFreqs.push_back(std::make_pair(color, 1));
+		if (histogram[color]) // save only appeared colors
+			colorFreqs.push_back(std::make_pair(color, histogram[color]));
 	}
 
 #ifdef _DEBUG
@@ -117,6 +153,12 @@ void Huffman::buildTree()
 	std::cout << "Building tree..." << std::endl;
 #endif
 
+	if (lengthLimit)
+	{
+		buildLimitedCodes();
+		return;
+	}
+
 	// Add all colors as single nodes
 	std::priority_queue<Node*, std::vector<Node*>, NodeCmp> trees; 
 	for (auto &v : colorFreqs)
@@ -190,6 +232,154 @@ void Huffman::buildTree()
 
 }
 
+std::vector<unsigned int> Huffman::limitedLengths(const std::vector<std::pair<uint32_t, uint32_t>> &colorFreqs, unsigned int limit)
+{
+	const size_t n = colorFreqs.size();
+	std::vector<unsigned int> lengths(n, 0);
+	if (n == 0)
+		return lengths;
+	if (n == 1)
+	{
+		lengths[0] = 1;
+		return lengths;
+	}
+
+	// Leaf is a color, package is a pair of items from previous list
+	struct Item
+	{
+		uint64_t weight;
+		size_t color; // index in colorFreqs (only for leaf)
+		size_t left, right; // indices of packed items
+		bool leaf;
+	};
+	std::vector<Item> items;
+	items.reserve(2 * n * limit);
+
+	// Leaves sorted by frequency (stable, so every decoder gets the same order)
+	std::vector<size_t> leaves(n);
+	for (size_t i = 0; i < n; ++i)
+		leaves[i] = i;
+	std::stable_sort(leaves.begin(), leaves.end(), [&colorFreqs](size_t a, size_t b)
+	{
+		return colorFreqs[a].second < colorFreqs[b].second;
+	});
+	for (auto i : leaves)
+		items.push_back({ colorFreqs[i].second, i, 0, 0, true });
+
+	std::vector<size_t> list(n), merged;
+	for (size_t i = 0; i < n; ++i)
+		list[i] = i;
+
+	// Every level merges leaves with packages of the previous level
+	for (unsigned int level = 1; level < limit; ++level)
+	{
+		merged.clear();
+		size_t leaf = 0, pair = 0;
+		while (leaf < n || pair + 1 < list.size())
+		{
+			bool takeLeaf = pair + 1 >= list.size()
+				|| (leaf < n && items[leaf].weight <= items[list[pair]].weight + items[list[pair + 1]].weight);
+			if (takeLeaf)
+				merged.push_back(leaf++);
+			else
+			{
+				items.push_back({ items[list[pair]].weight + items[list[pair + 1]].weight, 0, list[pair], list[pair + 1], false });
+				merged.push_back(items.size() - 1);
+				pair += 2;
+			}
+		}
+		list.swap(merged);
+	}
+
+	// Length of code is number of times the color is in the first 2n-2 items
+	std::vector<size_t> stack(list.begin(), list.begin() + (2 * n - 2));
+	while (!stack.empty())
+	{
+		const Item &item = items[stack.back()];
+		stack.pop_back();
+		if (item.leaf)
+			++lengths[item.color];
+		else
+		{
+			stack.push_back(item.left);
+			stack.push_back(item.right);
+		}
+	}
+
+	return lengths;
+}
+
+std::vector<std::pair<uint32_t, uint8_t>> Huffman::canonicalCodes(const std::vector<uint8_t> &lengths)
+{
+	std::vector<uint32_t> order;
+	for (uint32_t symbol = 0; symbol < lengths.size(); ++symbol)
+	{
+		if (lengths[symbol])
+			order.push_back(symbol);
+	}
+	std::stable_sort(order.begin(), order.end(), [&lengths](uint32_t a, uint32_t b)
+	{
+		return lengths[a] < lengths[b];
+	});
+
+	std::vector<std::pair<uint32_t, uint8_t>> codes(lengths.size(), std::make_pair(0u, uint8_t(0)));
+	uint32_t code = 0;
+	unsigned int length = 0;
+	for (auto symbol : order)
+	{
+		code <<= lengths[symbol] - length;
+		length = lengths[symbol];
+		codes[symbol] = std::make_pair(code, lengths[symbol]);
+		++code;
+	}
+	return codes;
+}
+
+std::vector<std::pair<uint16_t, uint8_t>> Huffman::lookupTable(const std::vector<std::pair<uint32_t, uint8_t>> &codes, unsigned int bits)
+{
+	std::vector<std::pair<uint16_t, uint8_t>> table(size_t(1) << bits, std::make_pair(uint16_t(0), uint8_t(0)));
+	for (size_t symbol = 0; symbol < codes.size(); ++symbol)
+	{
+		if (!codes[symbol].second)
+			continue;
+
+		const unsigned int free = bits - codes[symbol].second;
+		const size_t first = static_cast<size_t>(codes[symbol].first) << free;
+		std::fill(table.begin() + first, table.begin() + first + (size_t(1) << free),
+			std::make_pair(static_cast<uint16_t>(symbol), codes[symbol].second));
+	}
+	return table;
+}
+
+void Huffman::buildLimitedCodes()
+{
+	const std::vector<unsigned int> limited = limitedLengths(colorFreqs, lengthLimit);
+	std::vector<uint8_t> lengths(Histogram::size, 0);
+	for (size_t i = 0; i < colorFreqs.size(); ++i)
+		lengths[colorFreqs[i].first] = static_cast<uint8_t>(limited[i]);
+
+	// Canonical codes - shorter first, the same length ordered by color
+	const std::vector<std::pair<uint32_t, uint8_t>> codes = canonicalCodes(lengths);
+	for (unsigned int length = 1; length <= lengthLimit; ++length)
+	{
+		for (uint32_t color = 0; color < Histogram::size; ++color)
+		{
+			if (codes[color].second != length)
+				continue;
+
+			std::vector<bool> bits(length);
+			for (unsigned int k = 0; k < length; ++k)
+				bits[k] = ((codes[color].first >> (length - 1 - k)) & 1) != 0;
+			codeVec.push_back(std::make_pair(color, bits));
+		}
+	}
+
+#ifdef _DEBUG
+	printCodes();
+	std::cout << "Codes generated (limited to " << lengthLimit << " bits)." << std::endl;
+#endif
+}
+
 void Huffman::printCodes() const
 {
 	auto prev = std::cout.fill();
@@ -214,7 +404,9 @@ void Huffman::saveHuffHeader(std::ofstream &ofile) const
 
 	uint32_t clr;
 	unsigned int cntr;
-	size_t numberOfColors = colorFreqs.size();
+
+	// Limit of codes' length is saved in the highest bits (0 in older files)
+	size_t numberOfColors = colorFreqs.size() | static_cast<size_t>(lengthLimit) << limit_shift;
 
 	ofile.write(reinterpret_cast<const char*>(&numberOfColors), sizeof(numberOfColors));
 
@@ -242,10 +434,22 @@ void Huffman::readHuffHeader(std::ifstream &ifile)
 
 	ifile.read((char*)(&numOfColors), sizeof(numOfColors));
 
+	lengthLimit = static_cast<unsigned int>(numOfColors >> limit_shift) & 0xFF;
+	numOfColors &= (size_t(1) << limit_shift) - 1;
+	if (lengthLimit > max_length_limit || numOfColors == 0 || numOfColors > Histogram::size
+		|| (lengthLimit && (size_t(1) << lengthLimit) < numOfColors))
+	{
+		std::ostringstream os;
+		os << "Huffman header is not vaild (colors: " << numOfColors << ", length limit: " << lengthLimit << ").";
+		throw RuntimeError(os.str());
+	}
+
 	for (size_t i = 0; i < numOfColors; ++i)
 	{
 		ifile.read(reinterpret_cast<char *>(&clr), sizeof(clr));
 		ifile.read(reinterpret_cast<char *>(&cntr), sizeof(cntr));
+		if (clr >= Histogram::size)
+			throw RuntimeError("Huffman header is not vaild (color out of range).");
 		colorFreqs.push_back(std::make_pair(clr, cntr));
 	}
 
@@ -254,31 +458,69 @@ void Huffman::readHuffHeader(std::ifstream &ifile)
 #endif
 }
 
+std::vector<std::pair<uint32_t, unsigned int>> Huffman::encodingTable() const
+{
+	std::vector<std::pair<uint32_t, unsigned int>> codes(Histogram::size, std::make_pair(0u, 0u));
+	for (auto &v : codeVec)
+	{
+		uint32_t code = 0;
+		for (auto bit : v.second)
+			code = code << 1 | (bit ? 1 : 0);
+		codes[v.first & (Histogram::size - 1)] = std::make_pair(code, static_cast<unsigned int>(v.second.size()));
+	}
+	return codes;
+}
+
+unsigned int Huffman::longestCode() const
+{
+	size_t longest = 0;
+	for (auto &v : codeVec)
+		longest = std::max(longest, v.second.size());
+	return static_cast<unsigned int>(longest);
+}
+
+std::vector<std::pair<uint16_t, uint8_t>> Huffman::decodingTable(unsigned int bits) const
+{
+	// Codes are not longer than bits (so their lengths fit into byte)
+	const auto codes = encodingTable();
+	std::vector<std::pair<uint32_t, uint8_t>> shortCodes(codes.size());
+	for (size_t color = 0; color < codes.size(); ++color)
+		shortCodes[color] = std::make_pair(codes[color].first, static_cast<uint8_t>(codes[color].second));
+	return lookupTable(shortCodes, bits);
+}
+
 void Huffman::saveCodes(std::ofstream &ofile, const Image &image) const
 {
 #ifdef _DEBUG
 	std::cout << "Saving content..." << std::endl;
 #endif
 
-	uint32_t color;
-	BitsToFile btf(ofile);
+	// Code and its length for every color
+	auto codes = encodingTable();
 
+	BitWriter writer;
+
+	// Remarks: codes of not limited tree can be longer than 32 bits
 	auto img_end = image.end();
-	for (auto pixel_it = image.begin(); pixel_it < image.end(); ++pixel_it)
+	for (auto pixel_it = image.begin(); pixel_it < img_end; ++pixel_it)
 	{
-		color = pixel_it.value2();
-		for (auto &v : codeVec)
+		const auto &code = codes[pixel_it.value2() & (Histogram::size - 1)];
+		if (code.second <= 32)
+			writer.put(code.first, code.second);
+		else
 		{
-			if (v.first == color)
+			for (auto &v : codeVec)
 			{
-				btf.to(v.second);
-				break;
+				if (v.first == pixel_it.value2())
+				{
+					writer.put(v.second);
+					break;
+				}
 			}
 		}
-
 	}
 
-	btf.flush();
+	writer.write(ofile);
 #ifdef _DEBUG
 	std::cout << "Content saved." << std::endl;
 #endif
@@ -290,17 +532,48 @@ void Huffman::readCodes(std::ifstream &ifile, Image &image)
 	std::cout << "Reading content..." << std::endl;
 #endif
 
-	BitsFromFile bff(ifile);
-	std::vector<bool> vec;
-	bool found;
+	// Codes are read in chunks (the next one in background)
+	ChunkReader chunks(ifile);
+	BitReader reader(chunks);
 	auto img_end = image.end();
 
+	// Short codes are decoded with one look up into table indexed by following bits
+	const unsigned int bits = longestCode();
+	if (bits <= max_length_limit)
+	{
+		// Color and length of code starting with every possible bits (0 length when there is none)
+		auto table = decodingTable(bits);
+
+		for (auto pixel_it = image.begin(); pixel_it < img_end; ++pixel_it)
+		{
+			reader.refill();
+			const auto &entry = table[reader.peek(bits)];
+			if (entry.second == 0)
+				throw RuntimeError("Invaild Huffman code.");
+			reader.consume(entry.second);
+			pixel_it.value2(entry.first);
+		}
+
+		if (!reader.vaild())
+			throw RuntimeError("Unexpected end of Huffman data.");
+
+#ifdef _DEBUG
+		std::cout << "Content read." << std::endl;
+#endif
+		return;
+	}
+
+	std::vector<bool> vec;
+	bool found;
 	for (auto pixel_it = image.begin(); pixel_it < img_end; ++pixel_it)
 	{
 		found = false;
 		while (!found)
 		{
-			vec.push_back(bff.get());
+			vec.push_back(reader.get());
+			if (!reader.vaild())
+				throw RuntimeError("Unexpected end of Huffman data.");
+
 			for (auto &v : codeVec)
 			{
 				if (v.second == vec)
@@ -319,3 +592,182 @@ void Huffman::readCodes(std::ifstream &ifile, Image &image)
 #endif
 }
 
+
+void Huffman::saveStreams(std::ofstream &ofile, const Image &image) const
+{
+#ifdef _DEBUG
+	std::cout << "Saving content in " << streams << " streams..." << std::endl;
+#endif
+
+	auto codes = encodingTable();
+	std::array<BitWriter, streams> writers;
+
+	// Jump table - sizes of block's streams, followed by them
+	auto saveBlock = [&ofile, &writers]()
+	{
+		std::array<const std::vector<uint8_t>*, streams> bytes;
+		for (unsigned int i = 0; i < streams; ++i)
+			bytes[i] = &writers[i].flush();
+
+		uint32_t size;
+		for (auto b : bytes)
+		{
+			size = static_cast<uint32_t>(b->size());
+			ofile.write(reinterpret_cast<const char*>(&size), sizeof(size));
+		}
+
+		for (auto b : bytes)
+			ofile.write(reinterpret_cast<const char*>(b->data()), b->size());
+
+		writers = std::array<BitWriter, streams>();
+	};
+
+	const unsigned int width = image.width(),
+		height = image.height();
+
+	size_t stream = 0;
+	unsigned int blockPixels = 0;
+	for (unsigned int y = 0; y < height; ++y)
+	{
+		const uint16_t *row = reinterpret_cast<const uint16_t *>(image.row(y));
+		for (unsigned int x = 0; x < width; ++x)
+		{
+			const auto &code = codes[row[x] & (Histogram::size - 1)];
+			writers[stream].put(code.first, code.second);
+			stream = (stream + 1) % streams;
+
+			if (++blockPixels == stream_block)
+			{
+				saveBlock();
+				blockPixels = 0;
+			}
+		}
+	}
+
+	if (blockPixels)
+		saveBlock();
+
+#ifdef _DEBUG
+	std::cout << "Content saved." << std::endl;
+#endif
+}
+
+void Huffman::readStreams(std::ifstream &ifile, Image &image)
+{
+#ifdef _DEBUG
+	std::cout << "Reading content from " << streams << " streams..." << std::endl;
+#endif
+
+	if (!lengthLimit)
+		throw RuntimeError("Interleaved Huffman streams need limited codes.");
+
+	const unsigned int bits = longestCode();
+	auto table = decodingTable(bits);
+
+	// Blocks are read in chunks (the next one in background) and decoded one by one
+	ChunkReader chunks(ifile);
+	std::vector<uint8_t> buffer;
+	std::vector<uint16_t> decoded(stream_block);
+
+	// Stream of block never takes more bytes than its pixels coded with the longest codes
+	const size_t max_stream_size = (stream_block / streams * static_cast<size_t>(max_length_limit) + 7) / 8;
+
+	const unsigned int width = image.width(),
+		height = image.height();
+	const size_t pixels = static_cast<size_t>(width) * height;
+
+	for (size_t first = 0; first < pixels; first += stream_block)
+	{
+		std::array<uint32_t, streams> sizes;
+		if (chunks.read(reinterpret_cast<uint8_t *>(sizes.data()), sizeof(sizes)) != sizeof(sizes))
+			throw RuntimeError("Unexpected end of Huffman data.");
+
+		size_t total = 0;
+		for (auto size : sizes)
+		{
+			if (size > max_stream_size)
+				throw RuntimeError("Jump table of Huffman streams is not vaild.");
+			total += size;
+		}
+
+		buffer.resize(total);
+		if (chunks.read(buffer.data(), total) != total)
+			throw RuntimeError("Unexpected end of Huffman data.");
+
+		// Find beginning of every stream using jump table
+		std::vector<BitReader> readers;
+		const uint8_t *begin = buffer.data();
+		for (unsigned int i = 0; i < streams; ++i)
+		{
+			readers.emplace_back(begin, begin + sizes[i]);
+			begin += sizes[i];
+		}
+
+		const size_t count = std::min(static_cast<size_t>(stream_block), pixels - first);
+		BitReader &r0 = readers[0], &r1 = readers[1], &r2 = readers[2], &r3 = readers[3];
+		uint8_t lengths = 1;
+		size_t i = 0;
+
+		// Every stream gives one pixel in iteration (independent look ups run in parallel)
+		for (; i + streams <= count; i += streams)
+		{
+			r0.refill();
+			r1.refill();
+			r2.refill();
+			r3.refill();
+
+			const auto &e0 = table[r0.peek(bits)];
+			const auto &e1 = table[r1.peek(bits)];
+			const auto &e2 = table[r2.peek(bits)];
+			const auto &e3 = table[r3.peek(bits)];
+
+			r0.consume(e0.second);
+			r1.consume(e1.second);
+			r2.consume(e2.second);
+			r3.consume(e3.second);
+
+			decoded[i] = e0.first;
+			decoded[i + 1] = e1.first;
+			decoded[i + 2] = e2.first;
+			decoded[i + 3] = e3.first;
+
+			// Invaild code has 0 length
+			if (!e0.second || !e1.second || !e2.second || !e3.second)
+			{
+				lengths = 0;
+				break;
+			}
+		}
+
+		for (size_t stream = 0; i < count && lengths; ++i, stream = (stream + 1) % streams)
+		{
+			readers[stream].refill();
+			const auto &entry = table[readers[stream].peek(bits)];
+			readers[stream].consume(entry.second);
+			decoded[i] = entry.first;
+			lengths = entry.second;
+		}
+
+		if (!lengths)
+			throw RuntimeError("Invaild Huffman code.");
+		for (auto &reader : readers)
+			if (!reader.vaild())
+				throw RuntimeError("Unexpected end of Huffman data.");
+
+		// Place decoded pixels into rows (block can begin and end in the middle of row)
+		for (size_t done = 0; done < count;)
+		{
+			const size_t index = first + done;
+			const unsigned int y = static_cast<unsigned int>(index / width),
+				x = static_cast<unsigned int>(index % width);
+			const size_t length = std::min(static_cast<size_t>(width - x), count - done);
+			std::copy(decoded.begin() + done, decoded.begin() + done + length,
+				reinterpret_cast<uint16_t *>(image.row(y)) + x);
+			done += length;
+		}
+	}
+
+#ifdef _DEBUG
+	std::cout << "Content read." << std::endl;
+#endif
+}
@@ -1,4 +1,5 @@
 #include "Image.h"
+#include "SurfacePool.h"
 #include "CText.h"
 #include "RuntimeError.h"
 
@@ -18,10 +19,7 @@ SDL_Surface * Image::create(unsigned int width, unsigned int height, unsigned in
 #ifdef _DEBUG
 	std::cout << " -> [Image::create]: Creating new SDL_Surface." << std::endl;
 #endif
-	SDL_Surface *img = SDL_CreateRGBSurface(0, static_cast<int>(width), static_cast<int>(height), static_cast<int>(depth), 0, 0, 0, 0);
-	if (img == nullptr)
-		throw RuntimeError();
-	return img;
+	return SurfacePool::shared().acquire(width, height, depth);
 }
 
 SDL_Surface * Image::copy(const SDL_Surface *img) const
@@ -45,8 +43,16 @@ SDL_Surface * Image::copy(const SDL_Surface *img) const
 	// Allocate empty surface
 	new_img = create(w, h, img->format->BitsPerPixel);
 	
-	// Fast copy raw pixel data
-	SDL_memcpy(new_img->pixels, img->pixels, (img->h * img->pitch));
+	// Fast copy raw pixel data (row by row when rows are aligned differently)
+	if (new_img->pitch == img->pitch)
+		SDL_memcpy(new_img->pixels, img->pixels, (img->h * img->pitch));
+	else
+	{
+		const size_t length = static_cast<size_t>(w) * img->format->BytesPerPixel;
+		for (int y = 0; y < h; ++y)
+			SDL_memcpy(reinterpret_cast<uint8_t *>(new_img->pixels) + y * new_img->pitch,
+				reinterpret_cast<const uint8_t *>(img->pixels) + y * img->pitch, length);
+	}
 
 	return new_img;
 }
@@ -87,8 +93,12 @@ Image::Image(const SDL_Surface *img)
 }
 
 Image::Image(const Image &img)
-	: surface(copy(img.surface))
+	: surface(img.surface)
 {
+	// Pixels are copied on first modification (detach)
+	if (surface != nullptr)
+		SurfacePool::retain(surface);
+
 #ifdef _DEBUG
 	std::cout << "[Image]: Called copy constructor." << std::endl;
 #endif // _DEBUG
@@ -122,9 +132,8 @@ Image::~Image()
 	std::cout << " -> [" << CText("~Image", CText::Color::MAGENTA) << "]" << ((surface != nullptr) ? ": Deallocated SDL_Surface." : "")  << std::endl;
 #endif // _DEBUG
 
-	// Remarks: it is safe to pass NULL to SDL_FreeSurface function
-	// @see https://wiki.libsdl.org/SDL_FreeSurface#Remarks
-	SDL_FreeSurface(surface);
+	// Remarks: surface is kept for next Image if pool has space (it is safe to pass NULL)
+	SurfacePool::shared().release(surface);
 	surface = nullptr;
 }
 
@@ -189,19 +198,19 @@ bool Image::empty() const
 	return surface == nullptr;
 }
 
-Image::pixel_iterator::pixel_iterator(SDL_Surface * surface)
+Image::const_pixel_iterator::const_pixel_iterator(SDL_Surface * surface)
 	: s(surface), x(0), y(0),
 	// Gets first pixel data pointer
 	current(reinterpret_cast<uint8_t *>(s->pixels))
 {}
 
-Image::pixel_iterator::pixel_iterator(SDL_Surface * surface, size_t x, size_t y)
+Image::const_pixel_iterator::const_pixel_iterator(SDL_Surface * surface, size_t x, size_t y)
 	: s(surface), x(x), y(y),
 	// Gets current pixel data pointer from SDL_Surface->pixels
 	current(reinterpret_cast<uint8_t *>(s->pixels) + y * s->pitch + x * s->format->BytesPerPixel)
 {}
 
-Image::pixel_iterator & Image::pixel_iterator::operator++()
+Image::const_pixel_iterator & Image::const_pixel_iterator::operator++()
 {
 	++x;
 	if (x != static_cast<size_t>(s->w))
@@ -218,9 +227,9 @@ Image::pixel_iterator & Image::pixel_iterator::operator++()
 	return *this;
 }
 
-Image::pixel_iterator Image::pixel_iterator::operator++(int)
+Image::const_pixel_iterator Image::const_pixel_iterator::operator++(int)
 {
-	pixel_iterator ret = *this;
+	const_pixel_iterator ret = *this;
 
 	++x;
 	if (x != static_cast<size_t>(s->w))
@@ -237,12 +246,12 @@ Image::pixel_iterator Image::pixel_iterator::operator++(int)
 	return std::move(ret);
 }
 
-inline std::pair<size_t, size_t> Image::pixel_iterator::xy() const
+inline std::pair<size_t, size_t> Image::const_pixel_iterator::xy() const
 {
 	return std::make_pair(x, y);
 }
 
-std::array<uint8_t, 3> Image::pixel_iterator::rgb2() const
+std::array<uint8_t, 3> Image::const_pixel_iterator::rgb2() const
 {
 	uint32_t val = value2();
 
@@ -254,13 +263,13 @@ std::array<uint8_t, 3> Image::pixel_iterator::rgb2() const
 	};
 }
 
-uint32_t Image::pixel_iterator::value() const
+uint32_t Image::const_pixel_iterator::value() const
 {
 
 #ifdef _DEBUG
 	if (x >= static_cast<size_t>(s->w) || y >= static_cast<size_t>(s->h))
 	{
-		std::cerr << "!!! [Image::pixel_iterator::value]: " << CText("Wanted pixel out of Image range.") << std::endl;
+		std::cerr << "!!! [Image::const_pixel_iterator::value]: " << CText("Wanted pixel out of Image range.") << std::endl;
 		return 0;
 	}
 #endif
@@ -285,13 +294,13 @@ uint32_t Image::pixel_iterator::value() const
 	}
 }
 
-uint32_t Image::pixel_iterator::value2() const
+uint32_t Image::const_pixel_iterator::value2() const
 {
 
 #ifdef _DEBUG
 	if (x >= static_cast<size_t>(s->w) || y >= static_cast<size_t>(s->h))
 	{
-		std::cerr << "!!! [Image::pixel_iterator::value]: " << CText("Wanted pixel out of Image range.") << std::endl;
+		std::cerr << "!!! [Image::const_pixel_iterator::value]: " << CText("Wanted pixel out of Image range.") << std::endl;
 		return 0;
 	}
 
@@ -307,13 +316,13 @@ uint32_t Image::pixel_iterator::value2() const
 	return *reinterpret_cast<uint16_t *>(current);
 }
 
-uint8_t Image::pixel_iterator::gray2() const
+uint8_t Image::const_pixel_iterator::gray2() const
 {
 	SDL_Color col = color2();
 	return static_cast<uint8_t>(0.2126 * col.r + 0.7152 * col.g + 0.0722 * col.b);
 }
 
-SDL_Color Image::pixel_iterator::color() const
+SDL_Color Image::const_pixel_iterator::color() const
 {
 	uint32_t RGB = value();
 
@@ -332,7 +341,7 @@ SDL_Color Image::pixel_iterator::color() const
 	return COLOR;
 }
 
-SDL_Color Image::pixel_iterator::color2() const
+SDL_Color Image::const_pixel_iterator::color2() const
 {
 	uint32_t RGB = value2();
 
@@ -343,6 +352,27 @@ SDL_Color Image::pixel_iterator::color2() const
 	};
 }
 
+Image::pixel_iterator::pixel_iterator(SDL_Surface * surface)
+	: const_pixel_iterator(surface)
+{}
+
+Image::pixel_iterator::pixel_iterator(SDL_Surface * surface, size_t x, size_t y)
+	: const_pixel_iterator(surface, x, y)
+{}
+
+Image::pixel_iterator & Image::pixel_iterator::operator++()
+{
+	const_pixel_iterator::operator++();
+	return *this;
+}
+
+Image::pixel_iterator Image::pixel_iterator::operator++(int)
+{
+	pixel_iterator ret = *this;
+	const_pixel_iterator::operator++();
+	return ret;
+}
+
 void Image::pixel_iterator::value(uint32_t RGB)
 {
 
@@ -383,7 +413,7 @@ void Image::pixel_iterator::value(uint32_t RGB)
 	}
 }
 
-void Image::pixel_iterator::value2(uint32_t RGB2) const
+void Image::pixel_iterator::value2(uint32_t RGB2)
 {
 #ifdef _DEBUG
 	if (x >= static_cast<size_t>(s->w) || y >= static_cast<size_t>(s->h))
@@ -415,27 +445,81 @@ void Image::pixel_iterator::value2(uint8_t R4, uint8_t G4, uint8_t B4)
 	value2(RGB);
 }
 
-bool Image::pixel_iterator::operator==(const pixel_iterator & it) const
+bool Image::const_pixel_iterator::operator==(const const_pixel_iterator & it) const
 {
 	return s == it.s && x == it.x && y == it.y;
 }
 
-bool Image::pixel_iterator::operator!=(const pixel_iterator & it) const
+bool Image::const_pixel_iterator::operator!=(const const_pixel_iterator & it) const
 {
 	return x != it.x || y != it.y || s != it.s;
 }
 
-bool Image::pixel_iterator::operator<(const pixel_iterator & it) const
+bool Image::const_pixel_iterator::operator<(const const_pixel_iterator & it) const
 {
 	return s == it.s && ((y < it.y) || (y == it.y && x < it.x));
 }
 
-Image::pixel_iterator Image::begin() const
+Image::pixel_iterator Image::begin()
 {
+	detach();
 	return pixel_iterator(surface);
 }
 
-Image::pixel_iterator Image::end() const
+Image::pixel_iterator Image::end()
 {
+	detach();
 	return pixel_iterator(surface, 0, surface->h);
 }
+
+Image::const_pixel_iterator Image::begin() const
+{
+	return const_pixel_iterator(surface);
+}
+
+Image::const_pixel_iterator Image::end() const
+{
+	return const_pixel_iterator(surface, 0, surface->h);
+}
+
+Image::pixel_iterator Image::at(size_t x, size_t y)
+{
+	detach();
+	return pixel_iterator(surface, x, y);
+}
+
+Image::const_pixel_iterator Image::at(size_t x, size_t y) const
+{
+	return const_pixel_iterator(surface, x, y);
+}
+
+uint8_t * Image::row(unsigned int y)
+{
+	detach();
+	return reinterpret_cast<uint8_t *>(surface->pixels) + y * surface->pitch;
+}
+
+const uint8_t * Image::row(unsigned int y) const
+{
+	return reinterpret_cast<const uint8_t *>(surface->pixels) + y * surface->pitch;
+}
+
+void Image::detach()
+{
+	if (!shared())
+		return;
+
+#ifdef _DEBUG
+	std::cout << " -> [Image::detach]: Copying shared pixel data." << std::endl;
+#endif
+
+	// Other Images keep the old surface (release only drops this reference)
+	SDL_Surface *own = copy(surface);
+	SurfacePool::shared().release(surface);
+	surface = own;
+}
+
+bool Image::shared() const
+{
+	return surface != nullptr && SurfacePool::count(surface) > 1;
+}
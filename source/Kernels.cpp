@@ -0,0 +1,250 @@
+#include "Kernels.h"
+#include "PixelLayout.h"
+#include "CText.h"
+#include "RuntimeError.h"
+
+#include <iostream>
+#include <sstream>
+#include <cstdlib> // getenv
+
+// SIMD kernels are compiled for their own instruction sets (target attribute),
+// so the rest of the application stays generic
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KERNELS_X86
+#include <immintrin.h>
+#endif
+
+namespace
+{
+	//------------------------------GENERIC------------------------------
+
+	template<class Layout>
+	void convertRow(const uint8_t *source, uint16_t *converted, size_t pixels)
+	{
+		SDL_Color color;
+		for (size_t x = 0; x < pixels; ++x, source += Layout::bytes)
+		{
+			color = Layout::color(source);
+			converted[x] = PixelLayout::RGB444::pack(color.r, color.g, color.b);
+		}
+	}
+
+#ifdef KERNELS_X86
+
+	//------------------------------SSE4.2------------------------------
+
+	// 4 pixels (0xXXRRGGBB) to RGB444 values in 32 bit lanes
+	__attribute__((target("sse4.2")))
+	inline __m128i pack444(__m128i pixels)
+	{
+		const __m128i r = _mm_and_si128(_mm_srli_epi32(pixels, 12), _mm_set1_epi32(0x0F00)),
+			g = _mm_and_si128(_mm_srli_epi32(pixels, 8), _mm_set1_epi32(0x00F0)),
+			b = _mm_and_si128(_mm_srli_epi32(pixels, 4), _mm_set1_epi32(0x000F));
+		return _mm_or_si128(_mm_or_si128(r, g), b);
+	}
+
+	__attribute__((target("sse4.2")))
+	void xrgb32SSE42(const uint8_t *source, uint16_t *converted, size_t pixels)
+	{
+		size_t x = 0;
+		for (; x + 8 <= pixels; x += 8)
+		{
+			const __m128i low = pack444(_mm_loadu_si128(reinterpret_cast<const __m128i *>(source + 4 * x))),
+				high = pack444(_mm_loadu_si128(reinterpret_cast<const __m128i *>(source + 4 * x + 16)));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(converted + x), _mm_packus_epi32(low, high));
+		}
+
+		convertRow<PixelLayout::XRGB32>(source + 4 * x, converted + x, pixels - x);
+	}
+
+	__attribute__((target("sse4.2")))
+	void bgr24SSE42(const uint8_t *source, uint16_t *converted, size_t pixels)
+	{
+		// Spreads 4 pixels of 3 bytes to 32 bit lanes (0x00RRGGBB)
+		const __m128i spread = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+
+		// Remarks: 16 bytes are loaded for 12 used, so the last pixels are left for generic loop
+		size_t x = 0;
+		for (; x + 10 <= pixels; x += 8)
+		{
+			const __m128i low = pack444(_mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(source + 3 * x)), spread)),
+				high = pack444(_mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(source + 3 * x + 12)), spread));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(converted + x), _mm_packus_epi32(low, high));
+		}
+
+		convertRow<PixelLayout::BGR24>(source + 3 * x, converted + x, pixels - x);
+	}
+
+	//------------------------------AVX2------------------------------
+
+	// 8 pixels (0xXXRRGGBB) to RGB444 values in 32 bit lanes
+	__attribute__((target("avx2")))
+	inline __m256i pack444(__m256i pixels)
+	{
+		const __m256i r = _mm256_and_si256(_mm256_srli_epi32(pixels, 12), _mm256_set1_epi32(0x0F00)),
+			g = _mm256_and_si256(_mm256_srli_epi32(pixels, 8), _mm256_set1_epi32(0x00F0)),
+			b = _mm256_and_si256(_mm256_srli_epi32(pixels, 4), _mm256_set1_epi32(0x000F));
+		return _mm256_or_si256(_mm256_or_si256(r, g), b);
+	}
+
+	// Packs 16 values to 16 bits in order (packus works within 128 bit lanes)
+	__attribute__((target("avx2")))
+	inline void store444(uint16_t *converted, __m256i low, __m256i high)
+	{
+		const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(low, high), 0xD8);
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(converted), packed);
+	}
+
+	__attribute__((target("avx2")))
+	void xrgb32AVX2(const uint8_t *source, uint16_t *converted, size_t pixels)
+	{
+		size_t x = 0;
+		for (; x + 16 <= pixels; x += 16)
+		{
+			store444(converted + x,
+				pack444(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(source + 4 * x))),
+				pack444(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(source + 4 * x + 32))));
+		}
+
+		convertRow<PixelLayout::XRGB32>(source + 4 * x, converted + x, pixels - x);
+	}
+
+	// 8 pixels of 3 bytes (two loads of 16 bytes) spread to 32 bit lanes
+	__attribute__((target("avx2")))
+	inline __m256i spread24(const uint8_t *source)
+	{
+		const __m256i spread = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+			0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+		const __m256i bytes = _mm256_inserti128_si256(
+			_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(source))),
+			_mm_loadu_si128(reinterpret_cast<const __m128i *>(source + 12)), 1);
+		return _mm256_shuffle_epi8(bytes, spread);
+	}
+
+	__attribute__((target("avx2")))
+	void bgr24AVX2(const uint8_t *source, uint16_t *converted, size_t pixels)
+	{
+		// Remarks: 16 bytes are loaded for 12 used, so the last pixels are left for generic loop
+		size_t x = 0;
+		for (; x + 18 <= pixels; x += 16)
+			store444(converted + x, pack444(spread24(source + 3 * x)), pack444(spread24(source + 3 * x + 24)));
+
+		convertRow<PixelLayout::BGR24>(source + 3 * x, converted + x, pixels - x);
+	}
+
+#endif // KERNELS_X86
+}
+
+Kernels::Kernels(Level level)
+	: xrgb32(convertRow<PixelLayout::XRGB32>),
+	bgr24(convertRow<PixelLayout::BGR24>),
+	selected(level)
+{
+#ifdef KERNELS_X86
+	// Remarks: AVX-512 level uses AVX2 kernels (wider registers don't pay off for single rows)
+	if (level >= Level::AVX2)
+	{
+		xrgb32 = xrgb32AVX2;
+		bgr24 = bgr24AVX2;
+	}
+	else if (level == Level::SSE42)
+	{
+		xrgb32 = xrgb32SSE42;
+		bgr24 = bgr24SSE42;
+	}
+#endif
+}
+
+Kernels::Level Kernels::initial()
+{
+	const char *forced = std::getenv("RGB12_CPU");
+	if (forced == nullptr)
+		return detected();
+
+	try
+	{
+		Level level = parse(forced);
+		if (level <= detected())
+			return level;
+
+		std::cerr << '[' << CText("Warning", CText::Color::YELLOW) << "]: CPU doesn't support RGB12_CPU=" << forced << std::endl;
+	}
+	catch (const RuntimeError &error)
+	{
+		std::cerr << '[' << CText("Warning", CText::Color::YELLOW) << "]: " << error.what() << std::endl;
+	}
+
+	return detected();
+}
+
+const Kernels & Kernels::active()
+{
+	return instance();
+}
+
+Kernels & Kernels::instance()
+{
+	static Kernels kernels(initial());
+	return kernels;
+}
+
+Kernels::Level Kernels::detected()
+{
+#ifdef KERNELS_X86
+	static const Level best = []()
+	{
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+			return Level::AVX512;
+		if (__builtin_cpu_supports("avx2"))
+			return Level::AVX2;
+		if (__builtin_cpu_supports("sse4.2"))
+			return Level::SSE42;
+		return Level::Generic;
+	}();
+	return best;
+#else
+	return Level::Generic;
+#endif
+}
+
+Kernels::Level Kernels::level()
+{
+	return active().selected;
+}
+
+void Kernels::force(Level level)
+{
+	if (level > detected())
+	{
+		std::ostringstream os;
+		os << "CPU supports at most " << name(detected()) << " kernels (forced " << name(level) << ").";
+		throw RuntimeError(os.str());
+	}
+
+	instance() = Kernels(level);
+}
+
+Kernels::Level Kernels::parse(const std::string &levelName)
+{
+	for (auto level : { Level::Generic, Level::SSE42, Level::AVX2, Level::AVX512 })
+		if (levelName == name(level))
+			return level;
+
+	throw RuntimeError("Unknown CPU level: '" + levelName + "' (generic, sse4.2, avx2, avx512).");
+}
+
+const char * Kernels::name(Level level)
+{
+	switch (level)
+	{
+	case Level::SSE42:
+		return "sse4.2";
+	case Level::AVX2:
+		return "avx2";
+	case Level::AVX512:
+		return "avx512";
+	default:
+		return "generic";
+	}
+}
@@ -1,19 +1,52 @@
 #include "LZ77.h"
+#include "RuntimeError.h"
+#include "PixelLayout.h"
+#include "ChunkReader.h"
+
 #include <vector>
+#include <cstring> // memcpy, memmove
+#include <algorithm> // min
 
 #ifdef _DEBUG
 #include <iostream>
 #endif
 
-LZ77::LZ77()
+LZ77::LZ77(Layout layout, Level level, const Dictionary *dictionary)
 
 	//size of search buffer
 	:s_buff_size(17), 
 
 	// size of lookahead buffer
-	la_buff_size(20)
+	la_buff_size(20),
+
+	// order of coded nibbles
+	layout(layout),
+
+	// compression level
+	level(level),
+
+	// shared search buffer
+	dictionary(dictionary)
 {}
 
+std::vector<uint8_t> LZ77::searchBuffer(uint8_t first) const
+{
+	if (!dictionary)
+		return std::vector<uint8_t>(s_buff_size - 1, first);
+
+	// Components of the most common color as if they were before the first pixel
+	const uint16_t color = dictionary->commonColor();
+	const uint8_t rgb[3] = {
+		static_cast<uint8_t>((color >> 8) & 0x0F),
+		static_cast<uint8_t>((color >> 4) & 0x0F),
+		static_cast<uint8_t>(color & 0x0F) };
+
+	std::vector<uint8_t> buffer(s_buff_size);
+	for (size_t i = 0; i < buffer.size(); ++i)
+		buffer[i] = (layout == Layout::Planar) ? rgb[0] : rgb[(3 - (buffer.size() - i) % 3) % 3];
+	return buffer;
+}
+
 
 
 //------------------------------ENCODING------------------------------
@@ -27,80 +60,106 @@ void LZ77::encode(std::ofstream &ofile, const Image &image)
 #ifdef _DEBUG
 	std::cout<<"\n=== LZ77 COMPRESSION ==="<<std::endl;
 #endif
-	
-	// Image iterator
-	auto const img_end = image.end();
-	auto pixel_it = image.begin();
 
-	// Loading first pixel to initialization variables
-	std::array<uint8_t, 3> color = pixel_it.rgb2();
-	++pixel_it;
-	for (auto &c : color)
-		c >>= 4;
+	std::vector<uint8_t> data = loadNibbles(image);
+	if (data.empty())
+		return;
 
-	// Saving first subpixel
-	ofile.write(reinterpret_cast<const char*>(&color[0]), sizeof(color[0]));
+	// Initialization of search buffer - it is placed right before coded nibbles
+	// (filled with first subpixel, so the first one ends it, or from dictionary)
+	std::vector<uint8_t> buffer = searchBuffer(data[0]);
+	data.insert(data.begin(), buffer.begin(), buffer.end());
 
-	// Initialization of search buffer 	
-	for (int i = 0; i < static_cast<int>(s_buff_size); ++i)
-		s_buff.insert(std::make_pair(i, color[0]));
+	// Try every layout and keep the one needing the smallest number of codes
+	if (level == Level::Best)
+	{
+		const Layout chosen = layout;
+		size_t fewest = count_codes(data);
 
-	// Variable pointing the subpixel
-	short what_color = 1;
+		for (auto other : { Layout::Interleaved, Layout::Planar })
+		{
+			if (other == chosen)
+				continue;
 
-	// The first loading data to la_buff 
-	load_la_buff(color, pixel_it, img_end, what_color);
+			layout = other;
+			std::vector<uint8_t> candidate = loadNibbles(image);
+			buffer = searchBuffer(candidate[0]);
+			candidate.insert(candidate.begin(), buffer.begin(), buffer.end());
 
-	// Variables to search the longest sequence
-	short max_length = 0;
+			size_t codes = count_codes(candidate);
+			if (codes < fewest)
+			{
+				fewest = codes;
+				data.swap(candidate);
+			}
+			else layout = chosen;
+		}
+	}
 
-	// Main part of algorithm - loading data and coding
-	int it = 0;
-	while (la_buff.size() > 0)
+	// Saving layout (only when it is not default one, to stay compatible)
+	// Remarks: with dictionary the first code can be a sequence, so layout is always saved
+	if (layout != Layout::Interleaved || dictionary)
 	{
-		load_la_buff(color, pixel_it, img_end, what_color, (it - max_length + 1), la_buff_size);
-		max_length = create_code(ofile);
-		insert_elements_to_s_buff(max_length, it);
+		uint8_t header = layout_marker | static_cast<uint8_t>(layout);
+		ofile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	}
+
+	// Saving first subpixel (it is coded when search buffer is from dictionary)
+	if (!dictionary)
+		ofile.write(reinterpret_cast<const char*>(&data[s_buff_size - 1]), sizeof(data[0]));
 
-		popFront(s_buff, max_length);
-		popFront(la_buff, max_length);
+	// Main part of algorithm - coding the longest sequences
+	// Remarks: as every code takes one byte and the longest sequence at next position is
+	// at most one nibble shorter, taking the longest one always gives the fewest codes
+	size_t position = s_buff_size;
+	while (position < data.size())
+	{
+		auto sequence = find_sequence(data, position);
+		create_code(ofile, data, position, sequence.first, sequence.second);
+		position += sequence.first;
 	}
 
-//	la_buff.clear();
-	s_buff.clear();
 #ifdef _DEBUG
 	std::cout<<"\n=== LZ77 COMPRESSION DONE ==="<<std::endl;
 #endif
 }
 
 
-/** 
- * @param opened output stream
+/**
+ * @param search buffer followed by nibbles to code
+ * @return number of codes needed to save nibbles
  */
-short LZ77::create_code(std::ofstream &ofile)
+size_t LZ77::count_codes(const std::vector<uint8_t> &data) const
 {
-	auto s_begin = s_buff.begin();
-	auto s_end = s_buff.end();
-	auto la_begin = la_buff.begin();
-	auto la_end = la_buff.end();
-
-	short length = 0, 
-		max_length = 1, 
-		position = 0;
-	bool stop = false;
-		
-	// Searching the longest sequence
-	for(auto k = s_end; k != s_begin && !stop; --k)
+	size_t codes = 0;
+	for (size_t position = s_buff_size; position < data.size(); ++codes)
+		position += find_sequence(data, position).first;
+	return codes;
+}
+
+
+/**
+ * @param search buffer followed by nibbles to code
+ * @param position of first not coded nibble (search buffer ends right before it)
+ * @return pair of the longest sequence's length (1 if there is none) and its offset in search buffer
+ */
+std::pair<unsigned int, unsigned int> LZ77::find_sequence(const std::vector<uint8_t> &data, size_t position) const
+{
+	const size_t s_begin = position - s_buff_size;
+	const size_t la_end = std::min(data.size(), position + la_buff_size);
+
+	unsigned int length,
+		max_length = 1,
+		offset = 0;
+
+	// Searching the longest sequence (the closest one wins when equal)
+	for (unsigned int k = s_buff_size - 1; k > 0; --k)
 	{
-		auto count = k;
-		auto temp = la_begin;
-		while (count != s_end && temp != la_end && count->second == temp->second)
+		size_t count = s_begin + k;
+		size_t temp = position;
+		length = 0;
+		while (count != position && temp != la_end && data[count] == data[temp] && length < max_sequence)
 		{
-			if (length >= 9)
-			{
-				stop = true;
-				break;
-			}
 			++count;
 			++temp;
 			++length;
@@ -109,72 +168,94 @@ short LZ77::create_code(std::ofstream &ofile)
 		if (max_length < length)
 		{
 			max_length = length;
-			position = k->first;	
+			offset = k;
+			if (max_length == max_sequence)
+				break;
 		}
-
-		length = 0;
 	}
 
-	// Creating code of subpixels
-	if (max_length == 1)
-		ofile.write(reinterpret_cast<const char*>(&la_begin->second), sizeof(la_begin->second));
+	return std::make_pair(max_length, offset);
+}
+
+/** 
+ * @param opened output stream
+ * @param search buffer followed by nibbles to code
+ * @param position of first not coded nibble (search buffer ends right before it)
+ * @param length of coded sequence (1 for single subpixel)
+ * @param offset of sequence in search buffer
+ */
+void LZ77::create_code(std::ofstream &ofile, const std::vector<uint8_t> &data, size_t position, unsigned int length, unsigned int offset) const
+{
+	if (length == 1)
+		ofile.write(reinterpret_cast<const char*>(&data[position]), sizeof(data[position]));
 	else
 	{
-		uint8_t code = 128 | (max_length - 2) << 4 | (position - s_begin->first);
+		uint8_t code = static_cast<uint8_t>(128 | (length - 2) << 4 | offset);
 		ofile.write(reinterpret_cast<const char*>(&code), sizeof(code));
 	}
-
-	return max_length;
 }
 
-void LZ77::load_la_buff(std::array<uint8_t, 3> & color, Image::pixel_iterator & current, const Image::pixel_iterator & end, short & what_color, int it, int addition)
+std::vector<uint8_t> LZ77::loadNibbles(const Image &image) const
 {
-	while (la_buff.size() < la_buff_size && (current < end || what_color < 3))
+	using Layout444 = PixelLayout::RGB444;
+	const unsigned int width = image.width(),
+		height = image.height();
+	std::vector<uint8_t> nibbles(3 * static_cast<size_t>(width) * height);
+
+	// Distance between components of the same pixel, between following pixels
+	// and from the end of a row's components to the next row
+	const size_t component_step = (layout == Layout::Planar) ? width : 1,
+		pixel_step = (layout == Layout::Planar) ? 1 : 3,
+		row_step = (layout == Layout::Planar) ? 2 * static_cast<size_t>(width) : 0;
+
+	uint8_t *r = nibbles.data(),
+		*g = r + component_step,
+		*b = r + 2 * component_step;
+
+	uint32_t value;
+	for (unsigned int y = 0; y < height; ++y)
 	{
-		if (what_color < 3)
-		{
-			la_buff.insert(std::make_pair(addition + it, color[what_color]));
-			++it;
-			++what_color;
-		}
-		else
+		const uint8_t *pixel = image.row(y);
+		for (unsigned int x = 0; x < width; ++x, pixel += Layout444::bytes, r += pixel_step, g += pixel_step, b += pixel_step)
 		{
-			color = current.rgb2();
-			++current;
-			for (auto &c : color)
-				c >>= 4;
-			what_color = 0;
+			value = Layout444::value(pixel);
+			*r = Layout444::r4(value);
+			*g = Layout444::g4(value);
+			*b = Layout444::b4(value);
 		}
+		r += row_step;
+		g += row_step;
+		b += row_step;
 	}
-}
-
 
-/** 
- * @param size of the longest sequence
- * @param iterator pointing the beginning of search buffer
- */
-void LZ77::insert_elements_to_s_buff(short max_length, int &it)
-{
-	// Inserting elements into search buffer
-	auto la_begin = la_buff.begin();
-	while (max_length > 0)
-	{
-		s_buff.insert(std::make_pair(static_cast<int>(s_buff_size + it), la_begin->second));
-		++la_begin;
-		++it;
-		--max_length;
-	}
+	return nibbles;
 }
 
-void LZ77::popFront(std::map<int, uint8_t> & buffer, size_t n)
+void LZ77::storeNibbles(const uint8_t *nibbles, Image &image, unsigned int firstRow, unsigned int rows) const
 {
-	auto end = buffer.begin();
-	//n = (n < buffer.size()) ? n : buffer.size();		// security condition for debugging
-	std::advance(end, n);
-	buffer.erase(buffer.begin(), end);
-}
+	const unsigned int width = image.width();
 
+	const size_t component_step = (layout == Layout::Planar) ? width : 1,
+		pixel_step = (layout == Layout::Planar) ? 1 : 3,
+		row_step = (layout == Layout::Planar) ? 2 * static_cast<size_t>(width) : 0;
 
+	// Nibble of every component is placed in pixel value of RGB444 layout
+	using Layout444 = PixelLayout::RGB444;
+
+	const uint8_t *r = nibbles,
+		*g = nibbles + component_step,
+		*b = nibbles + 2 * component_step;
+
+	for (unsigned int y = firstRow; y < firstRow + rows; ++y)
+	{
+		uint8_t *pixel = image.row(y);
+		for (unsigned int x = 0; x < width; ++x, pixel += Layout444::bytes, r += pixel_step, g += pixel_step, b += pixel_step)
+			Layout444::store(pixel, static_cast<uint16_t>(*r << Layout444::r_shift | *g << Layout444::g_shift | *b << Layout444::b_shift));
+		r += row_step;
+		g += row_step;
+		b += row_step;
+	}
+}
 
 //------------------------------DECODING------------------------------
 
@@ -188,108 +269,91 @@ void LZ77::decode(std::ifstream &ifile, Image &image)
 	std::cout << "\n=== LZ77 DECOMPRESSION ===" << std::endl;
 #endif
 
-	//variables to decoding
-	short length = 0;
+	// Codes are read in chunks (the next one in background)
+	ChunkReader codes(ifile);
+	uint8_t c;
+	if (!codes.get(c))
+		throw RuntimeError("Unexpected end of LZ77 data.");
 
-	//colors of the one pixel
-	uint8_t color[3];
-
-	//variable pointing subpixel
-	short what_color = 1;
+	// Read layout if saved
+	layout = Layout::Interleaved;
+	if ((c & layout_marker) || dictionary)
+	{
+		uint8_t saved = c & ~layout_marker;
+		if (saved > static_cast<uint8_t>(Layout::Planar))
+			throw RuntimeError("Saved with unknown LZ77 layout.");
+		layout = static_cast<Layout>(saved);
+
+		// Remarks: with dictionary the first nibble is coded, so it is not read here
+		if (!dictionary && !codes.get(c))
+			throw RuntimeError("Unexpected end of LZ77 data.");
+	}
 
-	// Load whole file at once
-	std::vector<char> codes = std::vector<char>(std::istreambuf_iterator<char>(ifile), std::istreambuf_iterator<char>());
-	codes.push_back(0);
-	auto code = codes.begin();
+	const unsigned int width = image.width(),
+		height = image.height();
+	const size_t row_nibbles = 3 * static_cast<size_t>(width);
 
-	// Fill search buffer with first byte
-	color[0] = static_cast<uint8_t>(*code) << 4;
-	++code;
-	for (int i = 0; i < static_cast<int>(s_buff_size); ++i)
-		s_buff.insert(std::make_pair(i, color[0]));
+	// Nibbles are stored to rows in blocks (both layouts keep nibbles of a row together)
+	const unsigned int block_rows = std::min(height, static_cast<unsigned int>(rows_per_block));
 
-	auto pixel_it = image.begin();
-	auto codes_end = codes.end();
+	// Decoded subpixels placed right after search buffer filled with the first one or from dictionary
+	// (with some space at the end, so sequences can be copied by 8 bytes)
+	std::vector<uint8_t> nibbles = searchBuffer(c & 0x0F);
+	const size_t begin = nibbles.size();
+	nibbles.resize(begin + block_rows * row_nibbles + 2 * max_sequence, nibbles.back());
 
-	while(code < codes_end)
+	uint8_t *out = nibbles.data();
+	size_t position = s_buff_size;
+	unsigned int stored = 0;
+	while (stored < height)
 	{
-		length = read_code(static_cast<uint8_t>(*code));
-		put_elements_into_s_buff(length);
-		popFront(s_buff, length);
+		const unsigned int rows = std::min(block_rows, height - stored);
+		const size_t end = begin + rows * row_nibbles;
 
-		for (const auto p : la_buff)
+		while (position < end)
 		{
-			if (what_color >= 3)
+			if (!codes.get(c))
+				throw RuntimeError("Unexpected end of LZ77 data.");
+
+			if (c & 128)
 			{
-				pixel_it.value2(color[0], color[1], color[2]);
-				++pixel_it;
-				what_color = 0;
+				// sequence of subpixels from search buffer (offset 0 is never saved)
+				const unsigned int length = ((c >> 4) & 7) + 2;
+				if ((c & 0x0F) == 0)
+					throw RuntimeError("Invaild LZ77 code.");
+				const size_t from = position - s_buff_size + (c & 0x0F);
+
+				// Remarks: copied too many bytes are overwritten by following codes
+				if (position - from >= 8)
+				{
+					std::memcpy(out + position, out + from, 8);
+					out[position + 8] = out[from + 8];
+				}
+				else
+				{
+					for (unsigned int i = 0; i < length; ++i)
+						out[position + i] = out[from + i];
+				}
+				position += length;
+			}
+			else
+			{
+				// one subpixel
+				out[position] = c & 0x0F;
+				++position;
 			}
-
-			color[what_color] = p.second;
-			++what_color;
 		}
-		la_buff.clear();
-		++code;
+
+		storeNibbles(out + begin, image, stored, rows);
+		stored += rows;
+
+		// Search buffer and subpixels decoded after the block are moved to the beginning
+		const size_t shift = end - begin;
+		std::memmove(out, out + shift, position - shift);
+		position -= shift;
 	}
 
-	s_buff.clear();
 #ifdef _DEBUG
 	std::cout << "\n=== LZ77 DECOMPRESSION DONE ===" << std::endl;
 #endif
 }
-
-
-/** 
- * @param readed code
- */
-short LZ77::read_code(uint8_t code)
-{
-	auto s_first = s_buff.begin()->first;
-
-	uint8_t first_bit = code >> 7;
-	short length;
-	//checking what we have- one subpixel or sequence
-	if (first_bit)
-	{
-		//decoding sequence of subpixels in one byte
-		length = (static_cast<int>(code) >> 4) - 8;
-		short position = static_cast<int>(code) - 128 - (length << 4);
-		length += 2;
-
-		short it = 0;
-		while (it < length)
-		{
-			la_buff.insert(std::make_pair(s_first + it, s_buff[s_first + position + it]));
-			++it;
-		}
-	}
-	else
-	{
-		//decoding one subpixel
-		code = code << 4;
-		la_buff.insert(std::make_pair(0, code));
-		length = 1;
-	}
-	return length;
-}
-
-
-/** 
- * @param length of sequence of subpixels or one subpixel (=1)
- */
-void LZ77::put_elements_into_s_buff(short length)
-{
-	//inserting elements to search buffer
-	auto s_first = s_buff.begin()->first;
-	auto la_begin = la_buff.begin();
-
-	short it = 0;
-	while (length > 0)
-	{
-		s_buff.insert(std::make_pair(s_first + s_buff_size + it, la_begin->second));
-		++la_begin;
-		++it;
-		--length;
-	}
-}
@@ -0,0 +1,118 @@
+#include "PackedImage.h"
+#include "RGB12.h"
+
+PackedImage::PackedImage()
+	: w(0), h(0)
+{}
+
+PackedImage::PackedImage(unsigned int width, unsigned int height)
+	: bytes(size(width, height), 0), w(width), h(height)
+{}
+
+PackedImage::PackedImage(const Image &image)
+	: PackedImage(image.width(), image.height())
+{
+	for (unsigned int y = 0; y < h; ++y)
+		packRow(y, reinterpret_cast<const uint16_t *>(image.row(y)));
+}
+
+size_t PackedImage::size(unsigned int width, unsigned int height)
+{
+	return (3 * static_cast<size_t>(width) * height + 1) / 2;
+}
+
+size_t PackedImage::nibble(unsigned int y) const
+{
+	return 3 * static_cast<size_t>(w) * y;
+}
+
+void PackedImage::packRow(unsigned int y, const uint16_t *pixels)
+{
+	const size_t first = nibble(y);
+	uint8_t *out = bytes.data() + first / 2;
+	unsigned int x = 0;
+
+	// Row begins with red component in low nibble
+	if (first & 1)
+	{
+		const uint16_t pixel = pixels[0] & 0x0FFF;
+		out[0] = static_cast<uint8_t>((out[0] & 0xF0) | pixel >> 8);
+		out[1] = static_cast<uint8_t>(pixel);
+		out += 2;
+		x = 1;
+	}
+
+	// Every 2 pixels fill 3 bytes
+	for (; x + 1 < w; x += 2, out += 3)
+	{
+		const uint16_t a = pixels[x] & 0x0FFF,
+			b = pixels[x + 1] & 0x0FFF;
+		out[0] = static_cast<uint8_t>(a >> 4);
+		out[1] = static_cast<uint8_t>((a & 0x0F) << 4 | b >> 8);
+		out[2] = static_cast<uint8_t>(b);
+	}
+
+	// Last pixel ends in high nibble (low one belongs to next row)
+	if (x < w)
+	{
+		const uint16_t pixel = pixels[x] & 0x0FFF;
+		out[0] = static_cast<uint8_t>(pixel >> 4);
+		out[1] = static_cast<uint8_t>((pixel & 0x0F) << 4 | (out[1] & 0x0F));
+	}
+}
+
+void PackedImage::unpackRow(unsigned int y, uint16_t *pixels) const
+{
+	const size_t first = nibble(y);
+	const uint8_t *in = bytes.data() + first / 2;
+	unsigned int x = 0;
+
+	if (first & 1)
+	{
+		pixels[0] = static_cast<uint16_t>((in[0] & 0x0F) << 8 | in[1]);
+		in += 2;
+		x = 1;
+	}
+
+	for (; x + 1 < w; x += 2, in += 3)
+	{
+		pixels[x] = static_cast<uint16_t>(in[0] << 4 | in[1] >> 4);
+		pixels[x + 1] = static_cast<uint16_t>((in[1] & 0x0F) << 8 | in[2]);
+	}
+
+	if (x < w)
+		pixels[x] = static_cast<uint16_t>(in[0] << 4 | in[1] >> 4);
+}
+
+Image PackedImage::image() const
+{
+	Image unpacked(w, h, RGB12::supported_depth);
+	for (unsigned int y = 0; y < h; ++y)
+		unpackRow(y, reinterpret_cast<uint16_t *>(unpacked.row(y)));
+	return unpacked;
+}
+
+uint8_t * PackedImage::data()
+{
+	return bytes.data();
+}
+
+const uint8_t * PackedImage::data() const
+{
+	return bytes.data();
+}
+
+size_t PackedImage::size() const
+{
+	return bytes.size();
+}
+
+unsigned int PackedImage::width() const
+{
+	return w;
+}
+
+unsigned int PackedImage::height() const
+{
+	return h;
+}
@@ -0,0 +1,238 @@
+#include "Palette.h"
+#include "Huffman.h"
+#include "LZ77.h"
+#include "RGB12.h"
+#include "ChunkReader.h"
+#include "RuntimeError.h"
+
+#include <iostream>
+#include <sstream>
+
+Palette::Palette(Stage stage)
+	: stage(stage), colors(std::vector<uint32_t>())
+{
+	indices.fill(0);
+}
+
+bool Palette::build(const Image &image)
+{
+#ifdef _DEBUG
+	std::cout << "Building palette..." << std::endl;
+#endif
+
+	colors.clear();
+
+	Histogram histogram(image);
+	for (uint32_t color = 0; color < Histogram::size; ++color)
+	{
+		if (histogram[color])
+		{
+			if (colors.size() == max_colors)
+			{
+				colors.clear();
+				return false;
+			}
+
+			indices[color] = static_cast<uint8_t>(colors.size());
+			colors.push_back(color);
+		}
+	}
+
+#ifdef _DEBUG
+	std::cout << "Number of colors: " << colors.size() << std::endl;
+#endif
+
+	return true;
+}
+
+unsigned int Palette::indexBits() const
+{
+	unsigned int bits = 1;
+	while ((1u << bits) < colors.size())
+		bits <<= 1;
+	return bits;
+}
+
+Image Palette::indexImage(const Image &image) const
+{
+	Image indexed(image.width(), image.height(), RGB12::supported_depth);
+
+	auto img_end = image.end();
+	auto index_it = indexed.begin();
+	for (auto pixel_it = image.begin(); pixel_it < img_end; ++pixel_it, ++index_it)
+		index_it.value2(indices[pixel_it.value2() & (Histogram::size - 1)]);
+
+	return indexed;
+}
+
+void Palette::encode(std::ofstream &ofile, const Image &image)
+{
+#ifdef _DEBUG
+	std::cout << "\n=== PALETTE COMPRESSION ===" << std::endl;
+#endif
+
+	if (colors.empty() && !build(image))
+		throw RuntimeError("Image has too many colors to be saved with palette.");
+
+	savePalette(ofile);
+
+	switch (stage)
+	{
+	case Stage::Packed:
+		savePacked(ofile, image);
+		break;
+	case Stage::Huffman:
+	{
+		Huffman huffman;
+		huffman.encode(ofile, indexImage(image));
+		break;
+	}
+	case Stage::LZ77:
+	{
+		LZ77 lz77;
+		lz77.encode(ofile, indexImage(image));
+		break;
+	}
+	}
+
+#ifdef _DEBUG
+	std::cout << "=== PALETTE COMPRESSION DONE ===\n" << std::endl;
+#endif
+}
+
+void Palette::decode(std::ifstream &ifile, Image &image)
+{
+#ifdef _DEBUG
+	std::cout << "\n=== PALETTE DECOMPRESSION ===" << std::endl;
+#endif
+
+	readPalette(ifile);
+
+	if (stage == Stage::Packed)
+		loadPacked(ifile, image);
+	else
+	{
+		Image indexed(image.width(), image.height(), RGB12::supported_depth);
+		if (stage == Stage::Huffman)
+		{
+			Huffman huffman;
+			huffman.decode(ifile, indexed);
+		}
+		else
+		{
+			LZ77 lz77;
+			lz77.decode(ifile, indexed);
+		}
+
+		// Change indices back to colors
+		uint32_t index;
+		auto img_end = image.end();
+		auto index_it = indexed.begin();
+		for (auto pixel_it = image.begin(); pixel_it < img_end; ++pixel_it, ++index_it)
+		{
+			index = index_it.value2();
+			if (index >= colors.size())
+				throw RuntimeError("Saved palette index is out of range.");
+			pixel_it.value2(colors[index]);
+		}
+	}
+
+	colors.clear();
+
+#ifdef _DEBUG
+	std::cout << "=== PALETTE DECOMPRESSION DONE ===\n" << std::endl;
+#endif
+}
+
+void Palette::savePalette(std::ofstream &ofile) const
+{
+	uint16_t numberOfColors = static_cast<uint16_t>(colors.size()),
+		color;
+
+	ofile.write(reinterpret_cast<const char *>(&stage), sizeof(stage));
+	ofile.write(reinterpret_cast<const char *>(&numberOfColors), sizeof(numberOfColors));
+
+	for (auto c : colors)
+	{
+		color = static_cast<uint16_t>(c);
+		ofile.write(reinterpret_cast<const char *>(&color), sizeof(color));
+	}
+}
+
+void Palette::readPalette(std::ifstream &ifile)
+{
+	uint16_t numberOfColors, color;
+
+	ifile.read(reinterpret_cast<char *>(&stage), sizeof(stage));
+	ifile.read(reinterpret_cast<char *>(&numberOfColors), sizeof(numberOfColors));
+
+	if (static_cast<uint8_t>(stage) > static_cast<uint8_t>(Stage::LZ77) || numberOfColors == 0 || numberOfColors > max_colors)
+	{
+		std::ostringstream os;
+		os << "Palette header is not vaild (stage: " << static_cast<unsigned int>(stage)
+			<< ", colors: " << numberOfColors << ").";
+		throw RuntimeError(os.str());
+	}
+
+	colors.clear();
+	for (uint16_t i = 0; i < numberOfColors; ++i)
+	{
+		ifile.read(reinterpret_cast<char *>(&color), sizeof(color));
+		colors.push_back(color);
+	}
+}
+
+void Palette::savePacked(std::ofstream &ofile, const Image &image) const
+{
+	const unsigned int bits = indexBits();
+	unsigned int used = 0;
+	uint8_t block = 0;
+
+	auto img_end = image.end();
+	for (auto pixel_it = image.begin(); pixel_it < img_end; ++pixel_it)
+	{
+		block = static_cast<uint8_t>(block << bits) | indices[pixel_it.value2() & (Histogram::size - 1)];
+		used += bits;
+		if (used == 8)
+		{
+			ofile.write(reinterpret_cast<const char *>(&block), sizeof(block));
+			block = 0;
+			used = 0;
+		}
+	}
+
+	// Save last unfilled byte
+	if (used)
+	{
+		block <<= 8 - used;
+		ofile.write(reinterpret_cast<const char *>(&block), sizeof(block));
+	}
+}
+
+void Palette::loadPacked(std::ifstream &ifile, Image &image) const
+{
+	// Indices are read in chunks (the next one in background)
+	ChunkReader chunks(ifile);
+
+	const unsigned int bits = indexBits();
+	const uint8_t mask = static_cast<uint8_t>((1u << bits) - 1);
+	unsigned int left = 0;
+	uint8_t block = 0, index;
+
+	auto img_end = image.end();
+	for (auto pixel_it = image.begin(); pixel_it < img_end; ++pixel_it)
+	{
+		if (left == 0)
+		{
+			if (!chunks.get(block))
+				throw RuntimeError("Unexpected end of palette indices.");
+			left = 8;
+		}
+
+		left -= bits;
+		index = (block >> left) & mask;
+		if (index >= colors.size())
+			throw RuntimeError("Saved palette index is out of range.");
+		pixel_it.value2(colors[index]);
+	}
+}
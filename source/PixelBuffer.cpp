@@ -0,0 +1,190 @@
+#include "PixelBuffer.h"
+#include "RuntimeError.h"
+
+#include <new>      // nothrow
+#include <cstring>  // memcpy
+#include <sstream>  // thrown errors' messages
+#include <algorithm> // min
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+PixelBuffer::PixelBuffer()
+	: block(nullptr), pixels(nullptr), allocated(0), placement(Memory::Heap),
+	w(0), h(0), bytes(0), rowPitch(0)
+{}
+
+PixelBuffer::PixelBuffer(unsigned int width, unsigned int height, unsigned int bytesPerPixel, size_t alignment, size_t padding, Memory memory)
+	: PixelBuffer()
+{
+	if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+	{
+		std::ostringstream os;
+		os << "Alignment of pixel rows has to be power of 2 (given " << alignment << ").";
+		throw RuntimeError(os.str());
+	}
+
+	w = width;
+	h = height;
+	bytes = bytesPerPixel;
+
+	// Padding is inside pitch, so it can be read after every row
+	rowPitch = (static_cast<size_t>(width) * bytesPerPixel + padding + alignment - 1) & ~(alignment - 1);
+	const size_t size = rowPitch * height;
+
+#ifdef __linux__
+	// Mapped memory starts at page boundary (aligned enough for every usual alignment)
+	const size_t huge = 2u << 20;
+	if (memory == Memory::HugePages && alignment <= 4096u && size > 0)
+	{
+		allocated = (size + huge - 1) & ~(huge - 1);
+		void *mapped = mmap(nullptr, allocated, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (mapped != MAP_FAILED)
+		{
+#ifdef MADV_HUGEPAGE
+			madvise(mapped, allocated, MADV_HUGEPAGE);
+#endif
+			block = pixels = static_cast<uint8_t *>(mapped);
+			placement = Memory::HugePages;
+			return;
+		}
+	}
+#endif
+
+	// Remarks: block is bigger, so the first row can be moved to aligned address
+	//          and it is cleared like pixels of SDL_CreateRGBSurface
+	allocated = size + alignment - 1;
+	block = new (std::nothrow) uint8_t[allocated]();
+	if (block == nullptr)
+	{
+		std::ostringstream os;
+		os << "Cannot allocate " << allocated << " bytes of pixel data.";
+		throw RuntimeError(os.str());
+	}
+
+	const uintptr_t address = reinterpret_cast<uintptr_t>(block);
+	pixels = block + (((address + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1)) - address);
+	placement = Memory::Heap;
+}
+
+PixelBuffer PixelBuffer::from(const SDL_Surface *surface, size_t alignment, size_t padding)
+{
+	if (surface == nullptr)
+		return PixelBuffer();
+
+	PixelBuffer buffer(static_cast<unsigned int>(surface->w), static_cast<unsigned int>(surface->h),
+		surface->format->BytesPerPixel, alignment, padding);
+
+	// Rows are copied one by one, as pitches differ
+	const size_t length = std::min(buffer.pitch(), static_cast<size_t>(surface->pitch));
+	for (unsigned int y = 0; y < buffer.height(); ++y)
+		std::memcpy(buffer.row(y), reinterpret_cast<const uint8_t *>(surface->pixels) + y * surface->pitch, length);
+
+	return buffer;
+}
+
+PixelBuffer::PixelBuffer(PixelBuffer &&buffer)
+	: PixelBuffer()
+{
+	*this = std::move(buffer);
+}
+
+PixelBuffer & PixelBuffer::operator=(PixelBuffer &&buffer)
+{
+	if (this != &buffer)
+	{
+		deallocate();
+
+		block = buffer.block;
+		pixels = buffer.pixels;
+		allocated = buffer.allocated;
+		placement = buffer.placement;
+		w = buffer.w;
+		h = buffer.h;
+		bytes = buffer.bytes;
+		rowPitch = buffer.rowPitch;
+
+		// Zero-out moved buffer, so it doesn't free pixel data
+		buffer.block = buffer.pixels = nullptr;
+		buffer.allocated = buffer.rowPitch = 0;
+		buffer.w = buffer.h = buffer.bytes = 0;
+	}
+	return *this;
+}
+
+PixelBuffer::~PixelBuffer()
+{
+	deallocate();
+}
+
+void PixelBuffer::deallocate()
+{
+	if (block == nullptr)
+		return;
+
+#ifdef __linux__
+	if (placement == Memory::HugePages)
+		munmap(block, allocated);
+	else
+#endif
+		delete[] block;
+
+	block = pixels = nullptr;
+	allocated = 0;
+}
+
+SDL_Surface * PixelBuffer::surface(unsigned int depth) const
+{
+	if (static_cast<unsigned int>(depth + 7) / 8 != bytes)
+		return nullptr;
+
+	// Remarks: masks are chosen by SDL for depth (like SDL_CreateRGBSurface does)
+	return SDL_CreateRGBSurfaceFrom(pixels, static_cast<int>(w), static_cast<int>(h), static_cast<int>(depth),
+		static_cast<int>(rowPitch), 0, 0, 0, 0);
+}
+
+uint8_t * PixelBuffer::row(unsigned int y)
+{
+	return pixels + y * rowPitch;
+}
+
+const uint8_t * PixelBuffer::row(unsigned int y) const
+{
+	return pixels + y * rowPitch;
+}
+
+unsigned int PixelBuffer::width() const
+{
+	return w;
+}
+
+unsigned int PixelBuffer::height() const
+{
+	return h;
+}
+
+unsigned int PixelBuffer::bytesPerPixel() const
+{
+	return bytes;
+}
+
+size_t PixelBuffer::pitch() const
+{
+	return rowPitch;
+}
+
+size_t PixelBuffer::size() const
+{
+	return rowPitch * h;
+}
+
+PixelBuffer::Memory PixelBuffer::memory() const
+{
+	return placement;
+}
+
+bool PixelBuffer::empty() const
+{
+	return pixels == nullptr;
+}
@@ -1,12 +1,26 @@
 #include "RGB12.h"
 #include "LZ77.h"
 #include "Huffman.h"
+#include "AdaptiveHuffman.h"
+#include "Deflate.h"
+#include "ANS.h"
+#include "ChannelHuffman.h"
+#include "ColorTransform.h"
+#include "Histogram.h"
+#include "ThreadPool.h"
+#include "PixelLayout.h"
+#include "Kernels.h"
+#include "PackedImage.h"
+#include "ChunkReader.h"
 #include "CText.h"
 #include "RuntimeError.h"
 
 #include <iostream>
 #include <utility>
 #include <sstream>
+#include <vector>
+#include <algorithm> // stable_sort, min, max
+#include <cmath> // log2
 
 //const unsigned int RGB12::supported_depth = 12;
 
@@ -21,7 +35,7 @@ Image RGB12::convert(const Image& img) const
 		return img;
 	}
 
-	// Simply copy surface if it is already in proper format
+	// Simply share surface (copied on write) if it is already in proper format
 	if (img.depth() == RGB12::supported_depth)
 		return img;
 
@@ -29,37 +43,103 @@ Image RGB12::convert(const Image& img) const
 	std::cout << " -> [RGB12::convert]: Converting Image to RGB444 format." << std::endl;
 #endif
 
-	// Start conversion
+	// Start conversion (rows are converted in parallel)
 	Image converted(img.width(), img.height(), RGB12::supported_depth);
-	SDL_Color color;
-	auto conv_end = converted.end();
-	auto pixel_const = img.begin();
+	const unsigned int width = img.width();
 
-	for (auto pixel = converted.begin(); pixel != conv_end; ++pixel, ++pixel_const)
+#ifdef _DEBUG
+	if (!PixelLayout::RGB444::matches(converted.img()->format))
+		throw RuntimeError("Created surface has not RGB444 layout.");
+#endif
+
+	// Rows of common BMP formats are converted by the best kernel for this CPU
+	const SDL_PixelFormat *format = img.img()->format;
+	Kernels::ConvertRow kernel = nullptr;
+	if (PixelLayout::XRGB32::matches(format))
+		kernel = Kernels::active().xrgb32;
+	else if (PixelLayout::BGR24::matches(format))
+		kernel = Kernels::active().bgr24;
+
+	if (kernel != nullptr)
 	{
-		color = pixel_const.color();
-		color.r = (color.r >> 4) << 4;
-		color.g = (color.g >> 4) << 4;
-		color.b = (color.b >> 4) << 4;
-		pixel.value2(color.r, color.g, color.b);
+		ThreadPool::shared().parallelFor(0, img.height(), rows_per_chunk, [&](unsigned int, size_t first, size_t last)
+		{
+			for (size_t y = first; y < last; ++y)
+				kernel(img.row(static_cast<unsigned int>(y)), reinterpret_cast<uint16_t *>(converted.row(static_cast<unsigned int>(y))), width);
+		});
+
+		return converted;
 	}
 
+	// Otherwise layout of source pixels is chosen once, so rows are converted by inlined loop
+	PixelLayout::dispatch(format, [&](const auto &layout)
+	{
+		ThreadPool::shared().parallelFor(0, img.height(), rows_per_chunk, [&](unsigned int, size_t first, size_t last)
+		{
+			SDL_Color color;
+			for (size_t y = first; y < last; ++y)
+			{
+				const uint8_t *source = img.row(static_cast<unsigned int>(y));
+				uint8_t *pixel = converted.row(static_cast<unsigned int>(y));
+				for (unsigned int x = 0; x < width; ++x, source += layout.bytes, pixel += PixelLayout::RGB444::bytes)
+				{
+					color = layout.color(source);
+					PixelLayout::RGB444::store(pixel, PixelLayout::RGB444::pack(color.r, color.g, color.b));
+				}
+			}
+		});
+	});
+
 	return std::move(converted);
 }
 
+const std::array<uint8_t, Histogram::size>& RGB12::grayTable()
+{
+	static const std::array<uint8_t, Histogram::size> table = []()
+	{
+		std::array<uint8_t, Histogram::size> gray;
+		uint8_t r, g, b;
+		for (uint32_t color = 0; color < Histogram::size; ++color)
+		{
+			r = static_cast<uint8_t>(((color & 0x0F00) >> 8) << 4);
+			g = static_cast<uint8_t>(((color & 0x00F0) >> 4) << 4);
+			b = static_cast<uint8_t>((color & 0x000F) << 4);
+
+			// The same computation as Image::pixel_iterator::gray2()
+			gray[color] = static_cast<uint8_t>(0.2126 * r + 0.7152 * g + 0.0722 * b);
+		}
+		return gray;
+	}();
+
+	return table;
+}
+
 RGB12 & RGB12::toGrayScale()
 {
 #ifdef _DEBUG
 	std::cout << " -> [RGB12::toGrayScale]: Converting Image to grey scale." << std::endl;
 #endif // _DEBUG
 
-	uint8_t gray;
-	auto img_end = image.end();
-	for (auto pixel = image.begin(); pixel < img_end; ++pixel)
+	const auto &gray = grayTable();
+	const unsigned int width = image.width(),
+		height = image.height();
+
+	// Pixels shared with other Image are copied once, before rows are modified in parallel
+	image.detach();
+
+	ThreadPool::shared().parallelFor(0, height, rows_per_chunk, [&](unsigned int, size_t first, size_t last)
 	{
-		gray = (pixel.gray2() >> 4) << 4;
-		pixel.value2(gray, gray, gray);
-	}
+		uint16_t *row, g;
+		for (size_t y = first; y < last; ++y)
+		{
+			row = reinterpret_cast<uint16_t *>(image.row(static_cast<unsigned int>(y)));
+			for (unsigned int x = 0; x < width; ++x)
+			{
+				g = gray[row[x] & (Histogram::size - 1)] >> 4;
+				row[x] = static_cast<uint16_t>(g << 8 | g << 4 | g);
+			}
+		}
+	});
 
 	if (algorithm == Algorithm::BitDensity)
 		algorithm = Algorithm::GrayScale;
@@ -67,67 +147,368 @@ RGB12 & RGB12::toGrayScale()
 	return *this;
 }
 
+void RGB12::countDifferences(ChannelCounts &counts, uint16_t pixel, uint16_t predicted)
+{
+	++counts[0][((pixel >> 8) - (predicted >> 8)) & 0x0F];
+	++counts[1][((pixel >> 4) - (predicted >> 4)) & 0x0F];
+	++counts[2][(pixel - predicted) & 0x0F];
+}
+
+uint16_t RGB12::average(uint16_t left, uint16_t up)
+{
+	// Components are averaged at once (like ChannelHuffman's Average predictor)
+	return static_cast<uint16_t>((left & up) + (((left ^ up) & 0x0EEE) >> 1));
+}
+
+double RGB12::entropy(const uint32_t *counts, size_t size, size_t total)
+{
+	if (total == 0)
+		return 0.0;
+
+	double bits = 0.0;
+	const double all = static_cast<double>(total);
+	for (size_t i = 0; i < size; ++i)
+	{
+		if (counts[i])
+			bits += counts[i] * std::log2(all / counts[i]);
+	}
+	return bits / all;
+}
+
+double RGB12::channelsBits(const ChannelCounts &counts)
+{
+	// Lengths of codes of 16 differences are computed like in ChannelHuffman (entropy of skewed ones is too low)
+	uint64_t bits = 0, total = 0;
+	for (const auto &channel : counts)
+	{
+		std::vector<std::pair<uint32_t, uint32_t>> freqs;
+		for (uint32_t difference = 0; difference < channel.size(); ++difference)
+		{
+			if (channel[difference])
+				freqs.push_back(std::make_pair(difference, channel[difference]));
+		}
+
+		const std::vector<unsigned int> lengths = Huffman::limitedLengths(freqs, ChannelHuffman::max_length);
+		for (size_t i = 0; i < freqs.size(); ++i)
+		{
+			bits += static_cast<uint64_t>(freqs[i].second) * lengths[i];
+			total += freqs[i].second;
+		}
+	}
+	return total ? 3.0 * bits / total : 12.0;
+}
+
+RGB12 & RGB12::autoAlgorithm(unsigned int budget)
+{
+#ifdef _DEBUG
+	std::cout << " -> [RGB12::autoAlgorithm]: Choosing algorithm with budget: " << budget << std::endl;
+#endif
+
+	if (image.empty())
+		return *this;
+
+	// Sample only some rows of big images
+	const size_t max_sampled_pixels = 1u << 18;
+	const size_t width = image.width(),
+		height = image.height(),
+		pixels = width * height,
+		rowStep = 1 + pixels / max_sampled_pixels;
+
+	// Differences of components need fewer samples (only 16 values of every component)
+	const size_t max_channel_pixels = 1u << 16;
+	const size_t channelStep = rowStep * (1 + pixels / (rowStep * max_channel_pixels));
+
+	Histogram histogram(image, rowStep);
+	if (histogram.total() == 0)
+		return *this;
+
+	// Count pixels equal to the previous one (LZ77 codes them as long sequences), pixels equal to the previous
+	// or the upper one (Deflate tries them first) and colors of the others, which Deflate codes as literals
+	// Remarks: differences of components from predicted ones (ChannelHuffman) are counted
+	//          from original and transformed colors (ColorTransform)
+	const uint16_t mask = Histogram::size - 1;
+	size_t repeated = 0, matched = 0, literals = 0;
+	std::array<uint32_t, Histogram::size> literalCounts = {};
+	std::array<ChannelCounts, 6> differences = {}; // left, up, average, the same after transform
+	for (size_t y = 0; y < height; y += rowStep)
+	{
+		const uint16_t *row = reinterpret_cast<const uint16_t *>(image.row(static_cast<unsigned int>(y))),
+			*above = y ? reinterpret_cast<const uint16_t *>(image.row(static_cast<unsigned int>(y - 1))) : nullptr;
+		for (size_t x = 0; x < width; ++x)
+		{
+			const uint16_t current = row[x] & mask;
+			const bool equalLeft = x && current == (row[x - 1] & mask),
+				equalUp = above && current == (above[x] & mask);
+			if (equalLeft)
+				++repeated;
+			if (equalLeft || equalUp)
+				++matched;
+			else
+			{
+				++literalCounts[current];
+				++literals;
+			}
+
+			if (y % channelStep)
+				continue;
+
+			// The first row is predicted from the left, the first column from the upper neighbour (like ChannelHuffman)
+			const uint16_t left = x ? row[x - 1] & mask : (above ? above[x] & mask : 0),
+				up = above ? above[x] & mask : left;
+			countDifferences(differences[0], current, left);
+			countDifferences(differences[1], current, up);
+			countDifferences(differences[2], current, average(left, up));
+			const uint16_t transformed = ColorTransform::forward(current),
+				transformedLeft = ColorTransform::forward(left),
+				transformedUp = ColorTransform::forward(up);
+			countDifferences(differences[3], transformed, transformedLeft);
+			countDifferences(differences[4], transformed, transformedUp);
+			countDifferences(differences[5], transformed, average(transformedLeft, transformedUp));
+		}
+	}
+
+	const double sampled = static_cast<double>(histogram.total()),
+		repeatedRatio = repeated / sampled,
+		matchedRatio = matched / sampled,
+		colors = static_cast<double>(histogram.colors());
+
+	// Bits of components' codes with the best predictor (with and without transform)
+	const double channelBits = std::min({ channelsBits(differences[0]), channelsBits(differences[1]), channelsBits(differences[2]) }),
+		transformedBits = std::min({ channelsBits(differences[3]), channelsBits(differences[4]), channelsBits(differences[5]) });
+
+	// Estimated size (bits per pixel) and relative encoding cost of every candidate
+	struct Candidate
+	{
+		Algorithm alg;
+		double bits;
+		double cost;
+	};
+
+	std::vector<Candidate> candidates = {
+		{ Algorithm::BitDensity, 12.0, 1.0 },
+		// Codes + header (number of colors and 8 bytes per color)
+		{ Algorithm::Huffman, histogram.entropy() + (8.0 + colors * 8.0) * 8.0 / pixels, 2.0 + colors / 64.0 },
+		// Repeated pixels are covered by 9 nibbles long sequences, others mostly by single nibbles
+		{ Algorithm::LZ77, repeatedRatio * 3.0 + (1.0 - repeatedRatio) * 16.0, 16.0 },
+		// Literals take about 1.5 times their entropy (with codes of sequences between them),
+		// matched pixels are mostly in long sequences + header (about 4 bits per color and runs of unused ones)
+		{ Algorithm::Deflate, 1.5 * (1.0 - matchedRatio) * entropy(literalCounts.data(), literalCounts.size(), literals) + 0.3 * matchedRatio + (4.0 * colors + 512.0) / pixels, 10.0 },
+		// Codes close to entropy + header (about 12 bits per color and runs of unused ones)
+		{ Algorithm::ANS, histogram.entropy() + (12.0 * colors + 512.0) / pixels, 3.0 },
+		// Codes of components + header (predictor and 48 lengths)
+		{ Algorithm::ChannelHuffman, std::min(channelBits, transformedBits) + 200.0 / pixels, 3.0 }
+	};
+
+	// Packed indices + header (stage, number of colors and 2 bytes per color)
+	if (colors <= Palette::max_colors)
+	{
+		double indexBits = colors <= 2 ? 1.0 : colors <= 4 ? 2.0 : colors <= 16 ? 4.0 : 8.0;
+		candidates.push_back({ Algorithm::Palette, indexBits + (3.0 + colors * 2.0) * 8.0 / pixels, 1.5 });
+	}
+
+	if (algorithm == Algorithm::GrayScale)
+		candidates.push_back({ Algorithm::GrayScale, 4.0, 1.0 });
+
+	// Prefer cheaper algorithm unless slower one saves at least 5%
+	std::stable_sort(candidates.begin(), candidates.end(), [](const Candidate &c1, const Candidate &c2) -> bool
+	{
+		return c1.cost < c2.cost;
+	});
+
+	const double min_gain = 0.95;
+	const Candidate *best = nullptr;
+	for (const auto &c : candidates)
+	{
+		if (c.cost > budget)
+			continue;
+		if (best == nullptr || c.bits < best->bits * min_gain)
+			best = &c;
+	}
+
+	if (best != nullptr)
+	{
+		algorithm = best->alg;
+		if (algorithm == Algorithm::Palette)
+			paletteStage = Palette::Stage::Packed;
+		if (algorithm == Algorithm::ChannelHuffman && transformedBits < channelBits)
+			colorTransform = true;
+	}
+
+#ifdef _DEBUG
+	std::cout << "- Colors: " << colors << ", entropy: " << histogram.entropy() << ", repeated: " << repeatedRatio << ", matched: " << matchedRatio << std::endl;
+	std::cout << "- Channels: " << channelBits << " bits, transformed: " << transformedBits << " bits" << std::endl;
+	std::cout << "- Algorithm: " << static_cast<unsigned int>(algorithm) << ", transform: " << colorTransform << std::endl;
+#endif
+
+	return *this;
+}
+
 void RGB12::load444(std::ifstream &f, Image &img)
 {
 #ifdef _DEBUG
 	std::cout << " -> [RGB12::load444]: Run BitDensity load algorithm." << std::endl;
 #endif
 
-	std::vector<char> buffer = std::vector<char>(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+	const unsigned int width = img.width(),
+		height = img.height();
+
+	// Saved components are already packed, they are read in chunks (the next one in background)
+	// and unpacked in blocks of rows (even number of rows, so every block begins with whole byte)
+	ChunkReader chunks(f);
+	for (unsigned int y = 0; y < height; y += rows_per_chunk)
+	{
+		const unsigned int rows = std::min(static_cast<unsigned int>(rows_per_chunk), height - y);
+		PackedImage block(width, rows);
+		if (chunks.read(block.data(), block.size()) != block.size())
+			throw RuntimeError("Unexpected end of BitDensity data.");
+
+		for (unsigned int row = 0; row < rows; ++row)
+			block.unpackRow(row, reinterpret_cast<uint16_t *>(img.row(y + row)));
+	}
+}
+
+size_t RGB12::storedSize(const Image &img)
+{
+	// Even number of components is followed by empty byte (like in save444())
+	const size_t components = 3 * static_cast<size_t>(img.width()) * img.height();
+	return PackedImage::size(img.width(), img.height()) + (components % 2 == 0 ? 1 : 0);
+}
+
+void RGB12::saveGray(std::ofstream & output, const Image & img) const
+{
+	const auto &gray = grayTable();
+	const unsigned int width = img.width(),
+		height = img.height();
 
-	int colorToCode = 0;
-	std::array<uint8_t, 3> pixel;
-	auto pixel_iter = img.begin();
+	// Two pixels in every byte (rows are not separated)
+	std::vector<uint8_t> blocks((static_cast<size_t>(width) * height + 1) / 2, 0);
+	auto block = blocks.begin();
+	bool firstHalf = true;
 
-	for (auto i : buffer)
+	const uint16_t *row;
+	for (unsigned int y = 0; y < height; ++y)
 	{
-		for (int k = 0; k < 2; ++k)
+		row = reinterpret_cast<const uint16_t *>(img.row(y));
+		for (unsigned int x = 0; x < width; ++x)
 		{
-			pixel[colorToCode] = k ? (i << 4) : ((i >> 4) << 4);
-			++colorToCode;
-
-			if (colorToCode == 3)
+			if (firstHalf)
+				*block = gray[row[x] & (Histogram::size - 1)] & 0xF0;
+			else
 			{
-				pixel_iter.value2(pixel[0], pixel[1], pixel[2]);
-				++pixel_iter;
-				colorToCode = 0;
+				*block |= gray[row[x] & (Histogram::size - 1)] >> 4;
+				++block;
 			}
+			firstHalf = !firstHalf;
 		}
 	}
+
+	output.write(reinterpret_cast<const char*>(blocks.data()), blocks.size());
 }
 
-void RGB12::saveGray(std::ofstream & output, const Image & img) const
+void RGB12::saveGrayScale(const Image & img, std::string & filename) const
 {
-	auto img_end = img.end();
-	uint8_t block;
+#ifdef _DEBUG
+	std::cout << "\n -> [RGB12::saveGrayScale]: Converting and saving Image to: " << filename << std::endl;
+#endif
+
+	try
+	{
+		if (img.empty())
+			throw RuntimeError("Cannot save unintialized image.");
 
-	for (auto pixel = img.begin(); pixel < img_end; ++pixel)
+		std::string ext = extension();
+		if (!verifyExtension(filename, ext))
+			filename.append(ext);
+
+		std::ofstream f;
+		openStream(filename, f);
+		writeHeader(f, img, Algorithm::GrayScale);
+
+		const auto &gray = grayTable();
+		const unsigned int width = img.width(),
+			height = img.height();
+
+		// Bytes of one row (and half of byte left from previous one, so odd row can end one byte further)
+		std::vector<uint8_t> blocks((width + 1) / 2 + 1, 0);
+		bool firstHalf = true;
+
+		PixelLayout::dispatch(img.img()->format, [&](const auto &layout)
+		{
+			SDL_Color color;
+			uint8_t nibble;
+			for (unsigned int y = 0; y < height; ++y)
+			{
+				const uint8_t *pixel = img.row(y);
+				auto block = blocks.begin();
+				for (unsigned int x = 0; x < width; ++x, pixel += layout.bytes)
+				{
+					// Conversion to RGB444 (like convert()), gray scale pixel (like toGrayScale())
+					// and its gray nibble (like saveGray())
+					color = layout.color(pixel);
+					nibble = gray[PixelLayout::RGB444::pack(color.r, color.g, color.b)] >> 4;
+					nibble = gray[nibble << 8 | nibble << 4 | nibble] >> 4;
+
+					if (firstHalf)
+						*block = static_cast<uint8_t>(nibble << 4);
+					else
+					{
+						*block |= nibble;
+						++block;
+					}
+					firstHalf = !firstHalf;
+				}
+
+				// Not finished byte is moved to the beginning of next row
+				f.write(reinterpret_cast<const char*>(blocks.data()), block - blocks.begin());
+				if (!firstHalf)
+					blocks[0] = *block;
+			}
+		});
+
+		if (!firstHalf)
+			f.write(reinterpret_cast<const char*>(blocks.data()), 1);
+
+		f.close();
+	}
+	catch (const RuntimeError &error)
 	{
-		block = (pixel.gray2() >> 4) << 4;
-		++pixel;
-		block |= pixel.gray2() >> 4;
-		output.write(reinterpret_cast<char*>(&block), sizeof(block));
+		std::cerr << '[' << CText("RGB12 Saving Error") << "]: " << error.what() << std::endl;
 	}
+
+#ifdef _DEBUG
+	std::cout << " <- [RGB12::saveGrayScale]: Finished.\n" << std::endl;
+#endif
 }
 
 void RGB12::loadGray(std::ifstream & input, Image & img)
 {
-	std::vector<char> buffer = std::vector<char>(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+	const unsigned int width = img.width(),
+		height = img.height();
 
-	auto it = buffer.begin();
-	auto img_end = img.end();
+	// Two pixels in every byte (rows are not separated), read in chunks (the next one in background)
+	ChunkReader chunks(input);
+	uint8_t block = 0, gray;
+	bool firstHalf = true;
 
-	uint8_t gray;
-	for (auto pixel = img.begin(); pixel < img_end; ++pixel, ++it)
+	uint16_t *row;
+	for (unsigned int y = 0; y < height; ++y)
 	{
-		gray = (*it >> 4) << 4;
-		pixel.value2(gray, gray, gray);
-		++pixel;
+		row = reinterpret_cast<uint16_t *>(img.row(y));
+		for (unsigned int x = 0; x < width; ++x)
+		{
+			if (firstHalf)
+			{
+				if (!chunks.get(block))
+					throw RuntimeError("Unexpected end of gray scale data.");
+				gray = block >> 4;
+			}
+			else
+				gray = block & 0x0F;
+			firstHalf = !firstHalf;
 
-		gray = *it << 4;
-		pixel.value2(gray, gray, gray);
+			row[x] = static_cast<uint16_t>(gray << 8 | gray << 4 | gray);
+		}
 	}
-		
 }
 
 void RGB12::save444(std::ofstream &f, const Image &img) const
@@ -136,44 +517,29 @@ void RGB12::save444(std::ofstream &f, const Image &img) const
 	std::cout << " -> [RGB12::save444]: Run BitDensity save algorithm." << std::endl;
 #endif
 
-	bool isSpace = true,
-		firstHalf = true;
-	char usedChar = 0;
-	std::array<uint8_t, 3> color;
+	const unsigned int width = img.width(),
+		height = img.height();
 
-	auto img_end = img.end();
-	for (auto pixel = img.begin(); pixel < img_end; ++pixel)
+	// Rows are packed and saved in blocks (even number of rows, so every block begins with whole byte)
+	for (unsigned int y = 0; y < height; y += rows_per_chunk)
 	{
-		color = pixel.rgb2();
-		for (int k = 0; k < 3; ++k)
-		{
-			if (firstHalf)
-			{
-				usedChar = (color[k] >> 4) << 4;
-				firstHalf = false;
-			}
-			else
-			{
-				usedChar |= color[k] >> 4;
-				firstHalf = true;
-				isSpace = false;
-			}
+		const unsigned int rows = std::min(static_cast<unsigned int>(rows_per_chunk), height - y);
+		PackedImage block(width, rows);
+		for (unsigned int row = 0; row < rows; ++row)
+			block.packRow(row, reinterpret_cast<const uint16_t *>(img.row(y + row)));
 
-			if (!isSpace)
-			{
-				// Binary save
-				f.write(&usedChar, sizeof(usedChar));
-				isSpace = true;
-				usedChar = 0;
-			}
-		}
+		f.write(reinterpret_cast<const char *>(block.data()), block.size());
 	}
 
-	if (isSpace)
-		f.write(&usedChar, sizeof(usedChar));
+	// Remarks: even number of components is followed by empty byte (files were always saved so)
+	if ((3 * static_cast<size_t>(width) * height) % 2 == 0)
+	{
+		const char empty = 0;
+		f.write(&empty, sizeof(empty));
+	}
 }
 
-void RGB12::store(const std::string & filename, const Image & img) const
+void RGB12::store(const std::string & filename, const Image & source) const
 {
 #ifdef _DEBUG
 	std::cout << "\n -> [RG12::store]: Storing Image to file process has just begun." << std::endl;
@@ -183,30 +549,110 @@ void RGB12::store(const std::string & filename, const Image & img) const
 	// Load file to save data in binary mode
 	openStream(filename, f);
 
+	// Transform correlated components (gray scale saves only gray of original colors)
+	Algorithm alg = algorithm;
+	const bool transform = colorTransform && alg != Algorithm::GrayScale;
+	Image transformed;
+	if (transform)
+	{
+		transformed = source;
+		ColorTransform::apply(transformed);
+	}
+	const Image &img = transform ? transformed : source;
+
+	// Fall back to equivalent algorithm when Image cannot be indexed
+	Palette palette(paletteStage);
+	if (alg == Algorithm::Palette && !palette.build(img))
+	{
+		switch (paletteStage)
+		{
+		case Palette::Stage::Packed:
+			alg = Algorithm::BitDensity;
+			break;
+		case Palette::Stage::Huffman:
+			alg = Algorithm::Huffman;
+			break;
+		case Palette::Stage::LZ77:
+			alg = Algorithm::LZ77;
+			break;
+		}
+	}
+
+	// Only Huffman and LZ77 algorithms use dictionary
+	const Dictionary *used = (alg == Algorithm::Huffman || alg == Algorithm::InterleavedHuffman || alg == Algorithm::LZ77) ? dictionary : nullptr;
+
 	// Save global header needed to recover Image
-	writeHeader(f, img, algorithm);
+	writeHeader(f, img, alg, static_cast<uint8_t>((used ? dictionary_flag : 0) | (transform ? transform_flag : 0)));
+	const std::streamoff dataBegin = f.tellp();
 
 	// Save by chosen (or default) algorithm
-	switch (algorithm)
+	switch (alg)
 	{
 	case Algorithm::BitDensity:
 		save444(f, img);
 		break;
 	case Algorithm::Huffman:
 	{
-		Huffman huffman;
+		Huffman huffman(huffmanLength, false, used);
 		huffman.encode(f, img);
 		break;
 	}
 	case Algorithm::LZ77:
 	{
-		LZ77 lz77;
+		LZ77 lz77(lz77Layout, lz77Level, used);
 		lz77.encode(f, img);
 		break;
 	}
 	case Algorithm::GrayScale:
 		saveGray(f, img);
 		break;
+	case Algorithm::Palette:
+		palette.encode(f, img);
+		break;
+	case Algorithm::InterleavedHuffman:
+	{
+		Huffman huffman(huffmanLength, true, used);
+		huffman.encode(f, img);
+		break;
+	}
+	case Algorithm::AdaptiveHuffman:
+	{
+		AdaptiveHuffman huffman(huffmanLength);
+		huffman.encode(f, img);
+		break;
+	}
+	case Algorithm::Deflate:
+	{
+		Deflate deflate(lz77Level);
+		deflate.encode(f, img);
+		break;
+	}
+	case Algorithm::ANS:
+	{
+		ANS ans;
+		ans.encode(f, img);
+		break;
+	}
+	case Algorithm::ChannelHuffman:
+	{
+		ChannelHuffman huffman;
+		huffman.encode(f, img);
+		break;
+	}
+	}
+
+	// Compressed data larger than packed pixels (e.g. noise) is replaced by them,
+	// so saved file never expands and it is loaded as fast as BitDensity
+	const std::streamoff dataSize = f.tellp() - dataBegin;
+	if (alg != Algorithm::BitDensity && alg != Algorithm::GrayScale && dataSize > static_cast<std::streamoff>(storedSize(img)))
+	{
+#ifdef _DEBUG
+		std::cout << "- Compressed data (" << dataSize << " bytes) replaced by packed pixels (" << storedSize(img) << " bytes)" << std::endl;
+#endif
+		f.close();
+		openStream(filename, f);
+		writeHeader(f, img, Algorithm::BitDensity, transform ? transform_flag : 0);
+		save444(f, img);
 	}
 
 	// Close file
@@ -229,7 +675,9 @@ Image RGB12::recover(const std::string & filename)
 	// Read global header data
 	unsigned int width, height;
 	Algorithm alg;
-	std::tie(width, height, alg) = readHeader(f);
+	uint8_t flags;
+	std::tie(width, height, alg, flags) = readHeader(f);
+	const Dictionary *used = (flags & dictionary_flag) ? dictionary : nullptr;
 
 	// Create new empty Image
 	Image recovered(width, height, RGB12::supported_depth);
@@ -242,25 +690,64 @@ Image RGB12::recover(const std::string & filename)
 		break;
 	case Algorithm::Huffman:
 	{
-		Huffman huffman;
+		Huffman huffman(Huffman::default_max_length, false, used);
 		huffman.decode(f, recovered);
 		break;
 	}
 	case Algorithm::LZ77:
 	{
-		LZ77 lz77;
+		LZ77 lz77(LZ77::Layout::Interleaved, LZ77::Level::Fast, used);
 		lz77.decode(f, recovered);
 		break;
 	}
 	case Algorithm::GrayScale:
 		loadGray(f, recovered);
 		break;
+	case Algorithm::Palette:
+	{
+		Palette palette;
+		palette.decode(f, recovered);
+		break;
+	}
+	case Algorithm::InterleavedHuffman:
+	{
+		Huffman huffman(Huffman::default_max_length, true, used);
+		huffman.decode(f, recovered);
+		break;
+	}
+	case Algorithm::AdaptiveHuffman:
+	{
+		AdaptiveHuffman huffman;
+		huffman.decode(f, recovered);
+		break;
+	}
+	case Algorithm::Deflate:
+	{
+		Deflate deflate;
+		deflate.decode(f, recovered);
+		break;
+	}
+	case Algorithm::ANS:
+	{
+		ANS ans;
+		ans.decode(f, recovered);
+		break;
+	}
+	case Algorithm::ChannelHuffman:
+	{
+		ChannelHuffman huffman;
+		huffman.decode(f, recovered);
+		break;
+	}
 	default:
 		std::ostringstream os;
 		os << "Saved with uknown algorithm: [unsigned int] " << static_cast<unsigned int>(alg);
 		throw RuntimeError(os.str());
 	}
 
+	if (flags & transform_flag)
+		ColorTransform::revert(recovered);
+
 	// Close file
 	f.close();
 
@@ -279,7 +766,7 @@ Image RGB12::recover(const std::string & filename)
  *		uint8_t depth (bits per pixel),
  *		Algorithm chosen compression algorithm }
 */
-std::tuple<unsigned int, unsigned int, RGB12::Algorithm> RGB12::readHeader(std::ifstream &input) const
+std::tuple<unsigned int, unsigned int, RGB12::Algorithm, uint8_t> RGB12::readHeader(std::ifstream &input) const
 {
 #ifdef _DEBUG
 	std::cout << " -> [RGB12::readHeader]: Getting stored informations about this file." << std::endl;
@@ -314,16 +801,38 @@ std::tuple<unsigned int, unsigned int, RGB12::Algorithm> RGB12::readHeader(std::
 	input.read(reinterpret_cast<char *>(&height), sizeof(height));
 	input.read(reinterpret_cast<char *>(&alg), sizeof(alg));
 
+	// Read flags if saved
+	uint8_t flags = 0;
+	if (static_cast<uint8_t>(alg) & flags_marker)
+	{
+		alg = static_cast<Algorithm>(static_cast<uint8_t>(alg) & ~flags_marker);
+		input.read(reinterpret_cast<char *>(&flags), sizeof(flags));
+	}
+
+	// Check if the same dictionary is set
+	if (flags & dictionary_flag)
+	{
+		uint32_t id = 0;
+		input.read(reinterpret_cast<char *>(&id), sizeof(id));
+		if (!dictionary || dictionary->id() != id)
+		{
+			std::ostringstream os;
+			os << "File was saved with dictionary which is not set (ID: " << id << ").";
+			throw RuntimeError(os.str());
+		}
+	}
+
 #ifdef _DEBUG
 	std::cout << "- Algorithm: " << static_cast<unsigned int>(alg) << std::endl;
+	std::cout << "- Flags: " << static_cast<unsigned int>(flags) << std::endl;
 	std::cout << "- Width: " << width << std::endl;
 	std::cout << "- Height: " << height << std::endl;
 #endif
 
-	return std::make_tuple(width, height, alg);
+	return std::make_tuple(width, height, alg, flags);
 }
 
-void RGB12::writeHeader(std::ofstream &output, const Image &img, Algorithm alg) const
+void RGB12::writeHeader(std::ofstream &output, const Image &img, Algorithm alg, uint8_t flags) const
 {
 
 #ifdef _DEBUG
@@ -343,7 +852,22 @@ void RGB12::writeHeader(std::ofstream &output, const Image &img, Algorithm alg)
 	output.write(ext.c_str(), ext_size);
 	output.write(reinterpret_cast<const char *>(&width), sizeof(width));
 	output.write(reinterpret_cast<const char *>(&height), sizeof(height));
-	output.write(reinterpret_cast<const char *>(&alg), sizeof(alg));
+
+	// Flags are saved only when any is set (so older versions can read the file)
+	if (flags)
+	{
+		uint8_t marked = static_cast<uint8_t>(alg) | flags_marker;
+		output.write(reinterpret_cast<const char *>(&marked), sizeof(marked));
+		output.write(reinterpret_cast<const char *>(&flags), sizeof(flags));
+	}
+	else
+		output.write(reinterpret_cast<const char *>(&alg), sizeof(alg));
+
+	if (flags & dictionary_flag)
+	{
+		uint32_t id = dictionary->id();
+		output.write(reinterpret_cast<const char *>(&id), sizeof(id));
+	}
 }
 
 std::string RGB12::extension() const
@@ -352,7 +876,7 @@ std::string RGB12::extension() const
 }
 
 RGB12::RGB12(Algorithm alg)
-	: algorithm(alg)
+	: algorithm(alg), paletteStage(Palette::Stage::Packed), lz77Layout(LZ77::Layout::Interleaved), lz77Level(LZ77::Level::Fast), dictionary(nullptr), huffmanLength(Huffman::default_max_length), colorTransform(false)
 {
 #ifdef _DEBUG
 	std::cout << "[RGB12]: Called default constructor." << std::endl;
@@ -360,7 +884,7 @@ RGB12::RGB12(Algorithm alg)
 }
 
 RGB12::RGB12(const ImageHandler &img, Algorithm alg)
-	: ImageHandler(convert(img.image)), algorithm(alg) // affect when Image is protected
+	: ImageHandler(convert(img.image)), algorithm(alg), paletteStage(Palette::Stage::Packed), lz77Layout(LZ77::Layout::Interleaved), lz77Level(LZ77::Level::Fast), dictionary(nullptr), huffmanLength(Huffman::default_max_length), colorTransform(false) // affect when Image is protected
 {
 #ifdef _DEBUG
 	std::cout << "[RGB12]: Called convert ImageHandler constructor." << std::endl;
@@ -368,7 +892,7 @@ RGB12::RGB12(const ImageHandler &img, Algorithm alg)
 }
 
 RGB12::RGB12(const RGB12 &rgb)
-	: ImageHandler(rgb), algorithm(rgb.algorithm)
+	: ImageHandler(rgb), algorithm(rgb.algorithm), paletteStage(rgb.paletteStage), lz77Layout(rgb.lz77Layout), lz77Level(rgb.lz77Level), dictionary(rgb.dictionary), huffmanLength(rgb.huffmanLength), colorTransform(rgb.colorTransform)
 {
 #ifdef _DEBUG
 	std::cout << "[RGB12]: Called copy constructor." << std::endl;
@@ -376,7 +900,7 @@ RGB12::RGB12(const RGB12 &rgb)
 }
 
 RGB12::RGB12(RGB12 &&rgb)
-	: ImageHandler(std::move(rgb)), algorithm(rgb.algorithm)
+	: ImageHandler(std::move(rgb)), algorithm(rgb.algorithm), paletteStage(rgb.paletteStage), lz77Layout(rgb.lz77Layout), lz77Level(rgb.lz77Level), dictionary(rgb.dictionary), huffmanLength(rgb.huffmanLength), colorTransform(rgb.colorTransform)
 {
 #ifdef _DEBUG
 	std::cout << "[RGB12]: Called move constructor." << std::endl;
@@ -391,6 +915,12 @@ RGB12 & RGB12::operator=(const RGB12 &rgb)
 	
 	ImageHandler::operator=(rgb);
 	algorithm = rgb.algorithm;
+	paletteStage = rgb.paletteStage;
+	lz77Layout = rgb.lz77Layout;
+	lz77Level = rgb.lz77Level;
+	dictionary = rgb.dictionary;
+	huffmanLength = rgb.huffmanLength;
+	colorTransform = rgb.colorTransform;
 	return *this;
 }
 
@@ -401,5 +931,11 @@ RGB12 & RGB12::operator=(RGB12 &&rgb)
 #endif
 	ImageHandler::operator=(std::move(rgb));
 	algorithm = rgb.algorithm;
+	paletteStage = rgb.paletteStage;
+	lz77Layout = rgb.lz77Layout;
+	lz77Level = rgb.lz77Level;
+	dictionary = rgb.dictionary;
+	huffmanLength = rgb.huffmanLength;
+	colorTransform = rgb.colorTransform;
 	return *this;
 }
\ No newline at end of file
@@ -0,0 +1,137 @@
+#include "SurfacePool.h"
+#include "RuntimeError.h"
+
+#ifdef _DEBUG
+#include <iostream>
+#endif
+
+SurfacePool::SurfacePool()
+	: kept(0), capacity(0), hugeThreshold(0)
+{}
+
+SurfacePool::~SurfacePool()
+{
+	clear();
+}
+
+SurfacePool & SurfacePool::shared()
+{
+	static SurfacePool pool;
+	return pool;
+}
+
+void SurfacePool::limit(size_t bytes)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		capacity = bytes;
+	}
+
+	if (bytes == 0)
+		clear();
+}
+
+void SurfacePool::hugePages(size_t threshold)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	hugeThreshold = threshold;
+}
+
+void SurfacePool::destroy(SDL_Surface *surface)
+{
+	// Remarks: SDL doesn't free pixels of surface created from them (buffer does)
+	SDL_FreeSurface(surface);
+	owned.erase(surface);
+}
+
+SDL_Surface * SurfacePool::acquire(unsigned int width, unsigned int height, unsigned int depth)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto same = released.find(Key(width, height, depth));
+	if (same != released.end() && !same->second.empty())
+	{
+		SDL_Surface *surface = same->second.back();
+		same->second.pop_back();
+		kept -= static_cast<size_t>(surface->pitch) * surface->h;
+
+#ifdef _DEBUG
+		std::cout << " -> [SurfacePool::acquire]: Reused SDL_Surface." << std::endl;
+#endif
+		return surface;
+	}
+
+	const unsigned int bytesPerPixel = (depth + 7) / 8;
+	const bool huge = hugeThreshold && static_cast<size_t>(width) * height * bytesPerPixel >= hugeThreshold;
+
+	PixelBuffer buffer(width, height, bytesPerPixel, PixelBuffer::default_alignment, PixelBuffer::default_padding,
+		huge ? PixelBuffer::Memory::HugePages : PixelBuffer::Memory::Heap);
+
+	SDL_Surface *surface = buffer.surface(depth);
+	if (surface == nullptr)
+		throw RuntimeError();
+
+	owned.emplace(surface, Owned{ Key(width, height, depth), std::move(buffer) });
+	return surface;
+}
+
+SDL_atomic_t * SurfacePool::references(const SDL_Surface *surface)
+{
+	static_assert(sizeof(SDL_atomic_t) == sizeof(surface->refcount), "SDL_atomic_t has to be plain int.");
+	return reinterpret_cast<SDL_atomic_t *>(const_cast<int *>(&surface->refcount));
+}
+
+void SurfacePool::retain(SDL_Surface *surface)
+{
+	SDL_AtomicAdd(references(surface), 1);
+}
+
+int SurfacePool::count(const SDL_Surface *surface)
+{
+	return SDL_AtomicGet(references(surface));
+}
+
+void SurfacePool::release(SDL_Surface *surface)
+{
+	if (surface == nullptr)
+		return;
+
+	// Surface still used somewhere else only loses one reference
+	if (SDL_AtomicAdd(references(surface), -1) > 1)
+		return;
+
+	// SDL_FreeSurface drops the last reference itself
+	SDL_AtomicSet(references(surface), 1);
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// Surface from other source (e.g. loaded file)
+	auto it = owned.find(surface);
+	if (it == owned.end())
+	{
+		SDL_FreeSurface(surface);
+		return;
+	}
+
+	const size_t size = static_cast<size_t>(surface->pitch) * surface->h;
+	if (kept + size > capacity)
+	{
+		destroy(surface);
+		return;
+	}
+
+	kept += size;
+	released[it->second.key].push_back(surface);
+}
+
+void SurfacePool::clear()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (auto &same : released)
+		for (auto surface : same.second)
+			destroy(surface);
+
+	released.clear();
+	kept = 0;
+}
@@ -0,0 +1,133 @@
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <memory>
+#include <exception>
+#include <algorithm> // min, max
+
+#ifdef _DEBUG
+#include <iostream>
+#endif
+
+ThreadPool::ThreadPool(unsigned int threads)
+	: stopping(false)
+{
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+
+#ifdef _DEBUG
+	std::cout << "[ThreadPool]: Starting " << threads << " threads." << std::endl;
+#endif
+
+	// Calling thread is one of them
+	for (unsigned int i = 1; i < threads; ++i)
+		workers.emplace_back(&ThreadPool::work, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	condition.notify_all();
+
+	for (auto &worker : workers)
+		worker.join();
+}
+
+ThreadPool & ThreadPool::shared()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+unsigned int ThreadPool::threads() const
+{
+	return static_cast<unsigned int>(workers.size()) + 1;
+}
+
+void ThreadPool::work()
+{
+	std::function<void()> task;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [this] { return stopping || !tasks.empty(); });
+			if (tasks.empty())
+				return;
+
+			task = std::move(tasks.front());
+			tasks.pop();
+		}
+		task();
+	}
+}
+
+void ThreadPool::parallelFor(size_t begin, size_t end, size_t minChunk, const std::function<void(unsigned int, size_t, size_t)> &body)
+{
+	if (begin >= end)
+		return;
+
+	const size_t size = end - begin;
+	const unsigned int chunks = static_cast<unsigned int>(std::min<size_t>(threads(), std::max<size_t>(1, size / std::max<size_t>(1, minChunk))));
+
+	if (chunks == 1)
+	{
+		body(0, begin, end);
+		return;
+	}
+
+	// State shared with workers (they may still hold it after all chunks are done)
+	struct Job
+	{
+		std::atomic<unsigned int> next{ 0 };
+		std::atomic<unsigned int> done{ 0 };
+		std::exception_ptr error;
+		std::mutex mutex;
+		std::condition_variable finished;
+	};
+	auto job = std::make_shared<Job>();
+
+	// Takes chunks until there is none left (so it doesn't matter which thread runs them)
+	auto run = [job, chunks, begin, size, &body]()
+	{
+		unsigned int chunk;
+		while ((chunk = job->next++) < chunks)
+		{
+			try
+			{
+				body(chunk, begin + size * chunk / chunks, begin + size * (chunk + 1) / chunks);
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(job->mutex);
+				if (!job->error)
+					job->error = std::current_exception();
+			}
+
+			if (++job->done == chunks)
+			{
+				std::lock_guard<std::mutex> lock(job->mutex);
+				job->finished.notify_all();
+			}
+		}
+	};
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (unsigned int i = 1; i < chunks; ++i)
+			tasks.push(run);
+	}
+	condition.notify_all();
+
+	// Remarks: calling thread takes chunks too, so nested loops cannot wait for themselves
+	run();
+
+	std::unique_lock<std::mutex> lock(job->mutex);
+	job->finished.wait(lock, [&job, chunks] { return job->done == chunks; });
+
+	if (job->error)
+		std::rethrow_exception(job->error);
+}
@@ -3,6 +3,8 @@
 #include <sstream>
 #include <chrono>
 #include <utility>
+#include <fstream>
+#include <iterator>
 #include "SDL_Local.h"
 #include "Huffman.h"
 #include "BMP.h"
@@ -148,14 +150,15 @@ void test_BitDensity(const std::string &test)
 
 }
 
-void test_Huffman(const std::string &test)
+void test_Huffman(const std::string &test, unsigned int codeLength = Huffman::default_max_length, RGB12::Algorithm alg = RGB12::Algorithm::Huffman)
 {
 	BMP bmp;
 	bmp.load(test);
 	bmp.preview();
 
 	/// ENCODING
-	RGB12 rgb(bmp, RGB12::Algorithm::Huffman);
+	RGB12 rgb(bmp, alg);
+	rgb.huffmanLength = codeLength;
 	rgb.preview();
 	
 	auto begin = std::chrono::steady_clock::now();
@@ -218,6 +221,62 @@ void test_LZ77(const std::string &test)
 
 }
 
+void test_Deflate(const std::string &test)
+{
+	BMP bmp;
+	bmp.load(test);
+	bmp.preview();
+
+	RGB12 rgb(bmp, RGB12::Algorithm::Deflate);
+	rgb.preview();
+
+	auto begin = std::chrono::steady_clock::now();
+	rgb.save("test/deflate");
+	auto end = std::chrono::steady_clock::now();
+	showDuration(begin, end, "Deflate fully encoded");
+
+	RGB12 rgb2;
+	begin = std::chrono::steady_clock::now();
+	rgb2.load("test/deflate.rgb12");
+	end = std::chrono::steady_clock::now();
+	showDuration(begin, end, "Deflate decoded");
+
+	rgb2.preview();
+}
+
+void test_ColorTransform(const std::string &test, RGB12::Algorithm alg = RGB12::Algorithm::ChannelHuffman)
+{
+	BMP bmp;
+	bmp.load(test);
+
+	RGB12 rgb(bmp, alg);
+	rgb.colorTransform = true;
+
+	auto begin = std::chrono::steady_clock::now();
+	rgb.save("test/ycocg");
+	auto end = std::chrono::steady_clock::now();
+	showDuration(begin, end, "Transformed and encoded");
+
+	RGB12 rgb2;
+	begin = std::chrono::steady_clock::now();
+	rgb2.load("test/ycocg.rgb12");
+	end = std::chrono::steady_clock::now();
+	showDuration(begin, end, "Decoded and transformed back");
+
+	// Transform is lossless, so pixels have to be the same
+	auto it = rgb.image.begin();
+	for (auto pixel = rgb2.image.begin(); pixel != rgb2.image.end(); ++pixel, ++it)
+	{
+		if (pixel.value2() != it.value2())
+		{
+			cerr << "Transformed image differs from original one." << endl;
+			break;
+		}
+	}
+
+	rgb2.preview();
+}
+
 void test_Grey(const std::string &test)
 {
 	BMP bmp;
@@ -245,6 +304,117 @@ void test_Grey(const std::string &test)
 	showDuration(begin, end, "Grey decoded");
 	
 	grey.preview();
+
+	// Converting and saving at once (straight from BMP)
+	std::string fused = "test/grey_fused.rgb12";
+	begin = std::chrono::steady_clock::now();
+	grey.saveGrayScale(bmp.image, fused);
+	end = std::chrono::steady_clock::now();
+	showDuration(begin, end, "Grey converted and encoded");
+
+	grey.load(fused);
+	grey.preview();
+
+	// Fused saving has to give the same file as converting and saving (odd widths carry half of byte between rows)
+	rgb.save("test/grey_converted");
+	std::ifstream converted("test/grey_converted.rgb12", std::ios::binary), fusedFile(fused, std::ios::binary);
+	const std::string convertedBytes((std::istreambuf_iterator<char>(converted)), std::istreambuf_iterator<char>()),
+		fusedBytes((std::istreambuf_iterator<char>(fusedFile)), std::istreambuf_iterator<char>());
+	if (convertedBytes != fusedBytes)
+		cerr << "Fused grey scale file differs from converted one." << endl;
+}
+
+void test_CopyOnWrite(const std::string &test)
+{
+	BMP bmp;
+	bmp.load(test);
+	RGB12 rgb(bmp);
+	const Image &original = rgb.image;
+	const uint32_t first = original.begin().value2();
+
+	// Writing through copy leaves original unchanged
+	Image copy(original);
+	if (!copy.shared() || !original.shared())
+		cerr << "Copied Image doesn't share pixel data." << endl;
+	copy.begin().value2(first ^ 0x0FFF);
+	if (original.begin().value2() != first || copy.begin().value2() != (first ^ 0x0FFF))
+		cerr << "Writing through copy changed original Image." << endl;
+
+	// Row of shared Image is detached before it is returned
+	Image second(original);
+	const uint8_t *shared = original.row(0);
+	uint8_t *own = second.row(0);
+	if (own == shared || second.shared() || original.shared())
+		cerr << "Row of shared Image was not detached." << endl;
+	else
+		cout << "Copy-on-write OK." << endl;
+}
+
+void test_Palette(const std::string &test, Palette::Stage stage = Palette::Stage::Packed)
+{
+	BMP bmp;
+	bmp.load(test);
+	bmp.preview();
+
+	RGB12 rgb(bmp, RGB12::Algorithm::Palette);
+	rgb.paletteStage = stage;
+
+	auto begin = std::chrono::steady_clock::now();
+	rgb.save("test/palette");
+	auto end = std::chrono::steady_clock::now();
+	showDuration(begin, end, "Palette encoded");
+
+	RGB12 rgb2;
+	begin = std::chrono::steady_clock::now();
+	rgb2.load("test/palette.rgb12");
+	end = std::chrono::steady_clock::now();
+	showDuration(begin, end, "Palette decoded");
+
+	rgb2.preview();
+}
+
+void test_Auto(const std::string &test)
+{
+	BMP bmp;
+	bmp.load(test);
+
+	RGB12 rgb(bmp);
+
+	auto begin = std::chrono::steady_clock::now();
+	rgb.autoAlgorithm();
+	auto end = std::chrono::steady_clock::now();
+	showDuration(begin, end, "Algorithm chosen");
+	std::cout << "Algorithm: " << static_cast<unsigned int>(rgb.algorithm) << ", transform: " << rgb.colorTransform << std::endl;
+
+	rgb.save("test/auto");
+
+	RGB12 rgb2;
+	rgb2.load("test/auto.rgb12");
+	rgb2.preview();
+}
+
+void test_Dictionary(const std::string &test, RGB12::Algorithm alg = RGB12::Algorithm::Huffman)
+{
+	BMP bmp;
+	bmp.load(test);
+
+	// Train on the same image
+	RGB12 rgb(bmp, alg);
+	Dictionary dictionary(Huffman::default_max_length);
+	dictionary.add(rgb.image);
+	dictionary.save("test/dictionary.rgb12dict");
+	std::cout << "Dictionary ID: " << dictionary.id() << std::endl;
+
+	Dictionary loaded(Huffman::default_max_length);
+	loaded.load("test/dictionary.rgb12dict");
+
+	rgb.dictionary = &loaded;
+	rgb.save("test/dictionary");
+
+	RGB12 rgb2;
+	rgb2.dictionary = &loaded;
+	rgb2.load("test/dictionary.rgb12");
+	rgb2.preview();
 }
 
 void test_Image()
@@ -346,8 +516,19 @@ int main()
 	/// Algs
 	//test_BitDensity(testImg);
 	//test_Huffman(testImg);
+	//test_Huffman(testImg, Huffman::default_max_length, RGB12::Algorithm::InterleavedHuffman);
+	//test_Huffman(testImg, Huffman::default_max_length, RGB12::Algorithm::AdaptiveHuffman);
+	//test_Huffman(testImg, Huffman::default_max_length, RGB12::Algorithm::ANS);
+	//test_Huffman(testImg, Huffman::default_max_length, RGB12::Algorithm::ChannelHuffman);
 	test_LZ77(testImg);
+	//test_Deflate(testImg);
+	//test_ColorTransform(testImg);
 	//test_Grey(testImg);
+	//test_Grey("test/togrey.bmp"); // odd width
+	//test_CopyOnWrite(testImg);
+	//test_Palette(testImg);
+	//test_Auto(testImg);
+	//test_Dictionary(testImg);
 	//openCompressSaveBMP(testImg);
 
 	return 0;